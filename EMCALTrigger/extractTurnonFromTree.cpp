@@ -8,7 +8,7 @@ const std::array<std::string, 3> triggers = {"INT7", "EJ1", "EJ2"};
 
 TH1 *extractRawSpectrum(const std::string_view filename){
     const double binning[] = {10., 15., 20., 25., 30., 35., 40., 50., 60., 70, 80, 90., 100., 120., 140, 160., 200.};
-    ROOT::RDataFrame dataframe(GetNameJetSubstructureTree(filename), filename);
+    auto dataframe = GetJetSubstructureFrame(filename);
     auto rawspectrum = dataframe.Histo1D({"rawspectrum", "; p_{t} (GeV/c), N_{jet}", sizeof(binning)/sizeof(double)-1, binning}, "PtJetRec");
     auto result = new TH1D(*rawspectrum);
     result->SetDirectory(nullptr);
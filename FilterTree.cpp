@@ -1,75 +1,109 @@
 #ifndef __CLING__
+#include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
-#include <ROOT/TSeq.hxx>
+#include <ROOT/RDataFrame.hxx>
 #include <RStringView.h>
 #include <TFile.h>
 #include <TKey.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
 #include <TString.h>
 #include <TTree.h>
-#include <TTreeReader.h>
 #endif
 
-void FilterTree(std::string_view inputfile, double ptcut = 10.){
-  auto newfilename = inputfile.substr(0, inputfile.find_last_of(".")) + "_filtered.root";
+#include "helpers/instrumentation.C"
+#include "helpers/manifest.C"
+#include "helpers/string.C"
+#include "helpers/zonemap.C"
+
+/**
+ * Filter the jet substructure tree with a list of selections
+ *
+ * All branches are copied with their type as stored in the input tree. Clusters of
+ * the input tree are processed in parallel when nthreads > 1.
+ *
+ * @param inputfile File with the jet substructure tree
+ * @param ptcut Minimum detector-level jet pt, used if no selection is provided
+ * @param selections Selection expressions, separated by ";" (i.e. "PtJetRec > 20; NEFRec < 0.98")
+ * @param nthreads Number of threads used for the cluster-parallel processing
+ */
+void FilterTree(std::string_view inputfile, double ptcut = 10., std::string_view selections = "", int nthreads = 8){
+  auto newfilename = std::string(inputfile.substr(0, inputfile.find_last_of("."))) + "_filtered.root";
   std::cout << "Writing output to " << newfilename << std::endl;
 
   std::unique_ptr<TFile> infilereader(TFile::Open(inputfile.data(), "READ"));
-  TTree *substructuretree(nullptr);
-  for(auto t : *(infilereader->GetListOfKeys())){
-    if(TString(t->GetName()).Contains("jetSubstructure")){
-      substructuretree = static_cast<TTree *>(static_cast<TKey *>(t)->ReadObj());
-    }
+  if(!infilereader || infilereader->IsZombie()) {
+    std::cerr << "Cannot open input file " << inputfile << std::endl;
+    return;
   }
-  if(!substructuretree){
+  // Decide on the class name stored in the key - no need to deserialize the object
+  auto treekey = FindJetSubstructureKey(*infilereader);
+  std::string treename = treekey ? treekey->GetName() : "";
+  if(!treename.length()){
     std::cerr << "No substructure tree found in file " << inputfile << std::endl;
     return;
   }
-  std::cout << "Found tree " << substructuretree->GetName() << " in file " << inputfile << std::endl;
-  TTreeReader tread(substructuretree);
-  std::vector<TString> varnamesNew;
-  auto cutbranch = 0;
-  for(auto b : *(tread.GetTree()->GetListOfBranches())){
-    varnamesNew.emplace_back(static_cast<TBranch *>(b)->GetName());
-    std::cout << "Last branch: " << varnamesNew.back() << std::endl;
-    if(varnamesNew.back() == "PtJetRec") {
-      cutbranch = varnamesNew.size() - 1;
-      std::cout << "Found cut branch at position" << cutbranch << std::endl;
-    }
+  std::cout << "Found tree " << treename << " in file " << inputfile << std::endl;
+
+  std::vector<std::string> cuts;
+  for(const auto &sel : tokenize(std::string(selections), ';')) {
+    auto cut = trim(sel);
+    if(cut.length()) cuts.emplace_back(cut);
   }
-  std::cout << "Found " << varnamesNew.size() << " branches ...\n";
-  std::vector<std::unique_ptr<TTreeReaderValue<double>>> inputvalues;
-  for(auto ivar : varnamesNew){
-    inputvalues.emplace_back(std::unique_ptr<TTreeReaderValue<double>>(new TTreeReaderValue<double>(tread, ivar.Data())));
+  if(!cuts.size()) cuts.emplace_back(Form("PtJetRec >= %f", ptcut));
+
+  if(nthreads > 1) ROOT::EnableImplicitMT(nthreads);
+  // Sequential jobs (i.e. in the batch driver) read through their own file, so that the bytes
+  // read are counted per job. With implicit MT the data frame opens the file once per task,
+  // only the process-wide counter is available.
+  TFile *jobfile = ROOT::IsImplicitMTEnabled() ? nullptr : infilereader.get();
+  auto getBytesRead = [jobfile]() { return jobfile ? jobfile->GetBytesRead() : TFile::GetFileBytesRead(); };
+  std::unique_ptr<ROOT::RDataFrame> df(jobfile ? new ROOT::RDataFrame(*jobfile->Get<TTree>(treename.data())) : new ROOT::RDataFrame(treename, inputfile));
+  ROOT::RDF::RNode selected = *df;
+  for(const auto &cut : cuts) {
+    std::cout << "Applying selection " << cut << std::endl;
+    selected = selected.Filter(cut, cut);
   }
 
-  std::unique_ptr<TFile> writer(TFile::Open(newfilename, "RECREATE"));
-  writer->cd();
-  TTree *outputtree = new TTree("jetSubstructureFiltered", "filtered jet substructure tree");
-  double *jettreevalues = new double[varnamesNew.size()];
-  for(auto ib : ROOT::TSeqI(0, varnamesNew.size())){
-    outputtree->Branch(varnamesNew[ib], jettreevalues + ib, Form("%s/D", varnamesNew[ib].Data()));
+  // All results are booked before the event loop is triggered,
+  // the input tree is read only once
+  auto nentries = df->Count();
+  auto naccepted = selected.Count();
+  auto cutflow = df->Report();
+  ROOT::RDF::RSnapshotOptions options;
+  options.fLazy = true;
+  auto snapshot = selected.Snapshot("jetSubstructureFiltered", newfilename, "", options);
+
+  // own recorder: jobs of the batch driver share the process
+  Instrumentation instrumentation;
+  auto bytesbefore = getBytesRead();
+  TStopwatch timer;
+  timer.Start();
+  {
+    ScopedTimer filtertimer(instrumentation, "filter and snapshot", "filter");
+    *snapshot;
   }
+  timer.Stop();
+  auto bytesread = getBytesRead() - bytesbefore;
+  instrumentation.AddCounter("entries read", *nentries);
+  instrumentation.AddCounter("entries accepted", *naccepted);
+  instrumentation.SampleBytesRead(jobfile);
+  instrumentation.SampleMemory();
 
-  bool debug = false;
-  for(auto en : tread) {
-    TTreeReaderValue<double> &cutvalue = *(inputvalues[cutbranch]);
-    auto simvalue =*(*(inputvalues[3]));
-    auto dolog = debug && simvalue > 10.;
-    if(dolog) std::cout << "Found cut branch " << cutvalue.GetBranchName() << " with value " << *cutvalue << " (sim " <<  simvalue << ")";  
-    if(*cutvalue < ptcut) {
-      if(dolog) std::cout << " ... rejected" << std::endl;
-      continue; 
-    } else {
-      if(dolog) std::cout << " ... accepted" << std::endl;
-    }
+  cutflow->Print();
+  auto realtime = timer.RealTime() > 0 ? timer.RealTime() : 1e-9;
+  auto megabytes = static_cast<double>(bytesread) / (1024. * 1024.);
+  std::cout << "Accepted " << *naccepted << " of " << *nentries << " entries" << std::endl;
+  std::cout << "Throughput: " << static_cast<double>(*nentries) / realtime << " entries/s, "
+            << megabytes / realtime << " MB/s (" << megabytes << " MB in " << realtime << " s"
+            << (jobfile ? "" : ", bytes read by all files of the process (implicit MT)") << ")" << std::endl;
 
-    if(dolog) std::cout << "Filling new tree" << std::endl;
-    for(auto ib : ROOT::TSeqI(0, varnamesNew.size())) {
-      jettreevalues[ib] = *(*(inputvalues[ib]));
-    }
-    outputtree->Fill();
+  // min/max per cluster for the kinematic branches, used by range-aware readers
+  {
+    ScopedTimer zonemaptimer(instrumentation, "zone map", "filter");
+    WriteZoneMap(newfilename, "jetSubstructureFiltered");
   }
-  outputtree->Write();
-  delete[] jettreevalues;
-}
\ No newline at end of file
+  instrumentation.WriteTrace(newfilename.substr(0, newfilename.find_last_of(".")) + "_trace.json", jobfile);
+}
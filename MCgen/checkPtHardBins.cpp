@@ -3,23 +3,15 @@
 #include "../helpers/root.C"
 #include "../helpers/math.C"
 #include "../helpers/graphics.C"
+#include "../helpers/pthardweights.C"
 #include "../unfolding/binnings/binningPt1D.C"
 
 TH1 *getPtHardWeightedSpectrum(bool fine, int pthardbin, double r){
     std::stringstream filename;
     filename << "markusr" << int(r*10.) << "pt" << pthardbin << ".root";
-    double weightPythia;
-    {
-        std::cout << "reading spectrum from " << filename.str() << std::endl;
-        std::unique_ptr<TFile> filereader(TFile::Open(filename.str().data(), "READ"));
-        auto histlist = static_cast<TList *>(filereader->Get(Form("JetShapesMC_Jet_AKTFullR%02d0_mctracks_pT0000_E_scheme_HistosMC_GenShapes_NoSub_Incl", int(r*10.))));
-        auto hTrials = static_cast<TH1*>(histlist->FindObject("fHistTrialsAfterSel"));
-        auto hXsec = static_cast<TProfile*>(histlist->FindObject("fHistXsectionAfterSel"));
-        auto xsection = hXsec->GetBinContent(pthardbin+1);
-        auto nTrials  = hTrials->GetBinContent(pthardbin+1);
-        weightPythia  = xsection / nTrials;
-        std::cout << "found cross section " << weightPythia << std::endl;
-    }
+    std::cout << "reading spectrum from " << filename.str() << std::endl;
+    double weightPythia = GetPtHardWeightForFile(filename.str(), Form("JetShapesMC_Jet_AKTFullR%02d0_mctracks_pT0000_E_scheme_HistosMC_GenShapes_NoSub_Incl", int(r*10.)), pthardbin, pthardbin+1, PtHardWeightHistogramsAfterSel()).fWeight;
+    std::cout << "found cross section " << weightPythia << std::endl;
     std::vector<double> binningpart;
     if(fine) {
         for(auto b : ROOT::TSeqI(0, 301)) binningpart.emplace_back(b);
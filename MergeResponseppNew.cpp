@@ -4,12 +4,17 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <string>
 #include <vector>
 #include <tuple>
+#include "ROOT/TBufferMerger.hxx"
+#include "ROOT/TThreadExecutor.hxx"
 #include "TList.h"
 #include "ROOT/TSeq.hxx"
 #include <RStringView.h>
+#include <TBranch.h>
 #include <TKey.h>
+#include <TLeaf.h>
 #include "TSystem.h"
 #include "TFile.h"
 #include "TDirectory.h"
@@ -17,80 +22,182 @@
 #include "TH2F.h"
 #include "TTree.h"
 #include "TString.h"
-#include "TProfile.h"
-#include "TCanvas.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
 #endif
 
-std::tuple<std::vector<int>, bool> GetPtHardBins(std::string_view inputdir){
-  std::vector<int> pthardbins;
-  bool usechilds(false);
-  TString dirstring = gSystem->GetFromPipe(Form("ls -1 %s", inputdir.data()));
-  std::unique_ptr<TObjArray> dirs(dirstring.Tokenize("\n"));
-  for(auto d : TRangeDynCast<TObjString>(dirs.get())){
-    if(!d) continue;
-    TString mydir = d->String();
-    if(mydir.IsDigit()) {
-      pthardbins.emplace_back(mydir.Atoi());
-      usechilds = false;
-    } else {
-      if(mydir.Contains("child_")){
-        mydir.ReplaceAll("child_", "");
-        pthardbins.emplace_back(mydir.Atoi());
-        usechilds = true;
-      }
-    }
+#include "helpers/instrumentation.C"
+#include "helpers/pthard.C"
+#include "helpers/pthardweights.C"
+#include "helpers/zonemap.C"
+
+/**
+ * Branches computed during merging, always written by the merger. Input branches
+ * with the same name are not copied.
+ */
+const std::vector<std::string> kMergeComputedBranches = {"PythiaWeight", "PtHardBin", "OutlierMask"};
+
+/**
+ * Branches copied from an input tree (name and type), computed branches excluded
+ */
+std::vector<std::string> GetCopiedBranches(TTree &tree) {
+  std::vector<std::string> result;
+  for(auto b : TRangeDynCast<TBranch>(tree.GetListOfBranches())) {
+    if(!b) continue;
+    if(std::find(kMergeComputedBranches.begin(), kMergeComputedBranches.end(), b->GetName()) != kMergeComputedBranches.end()) continue;
+    auto leaf = static_cast<TLeaf *>(b->GetListOfLeaves()->At(0));
+    result.emplace_back(std::string(b->GetName()) + "/" + (leaf ? leaf->GetTypeName() : b->GetClassName()));
   }
-  return std::make_tuple(pthardbins, usechilds);
+  return result;
 }
 
-void MergeResponseppNew(std::string_view inputdir, std::string_view treename, std::string_view rootfile = "AnalysisResults.root"){
+/**
+ * Merge the jet substructure trees of all pt-hard bins into one tree
+ *
+ * Each input tree is read exactly once and streamed into the output tree,
+ * PythiaWeight and PtHardBin are added as computed branches in the output
+ * only (input trees are not modified, branches of the same name in the input are
+ * replaced). The structure of the output tree is decided once from the first
+ * readable input, pt-hard bins with different branches are skipped. Pt-hard bins are processed concurrently,
+ * the output is assembled by a TBufferMerger. Every worker sends its buffer to
+ * the merger after flushentries entries, so memory stays bounded independent
+ * of the number of bins and entries.
+ *
+ * With outliermask the outlier decisions for the standard outlier factors are
+ * stored as bitmask column OutlierMask (see helpers/pthard.C), so readers do
+ * not need to evaluate the outlier rejection again.
+ */
+void MergeResponseppNew(std::string_view inputdir, std::string_view treename, std::string_view rootfile = "AnalysisResults.root", int nthreads = 4, Long64_t flushentries = 500000, bool outliermask = true){
   auto respthardbins = GetPtHardBins(inputdir);
   auto pthardbins = std::get<0>(respthardbins);
   auto usechilds = std::get<1>(respthardbins);
-  std::sort(pthardbins.begin(), pthardbins.end(), std::less<int>());
   std::cout << "Found " << pthardbins.size() << " pt-hard bins" << std::endl;
-  TList weighted;
-  std::vector<std::shared_ptr<TFile>> treefiles;
 
-  Double_t pythiaweight(0.); // Variable needde for new branch
-  std::unique_ptr<TFile> output(TFile::Open(Form("%s_merged.root", treename.data()), "RECREATE"));
   TString dirname(treename);
   dirname.ReplaceAll("Tree", "");
+  auto weights = GetPtHardWeightCatalogue(inputdir, rootfile, dirname.Data());
 
-  for(auto b : pthardbins){
-    // Read in weights
-    TString inputfile = usechilds ? Form("%s/child_%d/%s", inputdir.data(), b, rootfile.data()) : Form("%s/%02d/%s", inputdir.data(), b, rootfile.data());
-    std::shared_ptr<TFile> filereader(TFile::Open(inputfile, "READ")); 
-    treefiles.push_back(filereader);
-    filereader->cd(dirname);
-    auto histos = static_cast<TKey *>(gDirectory->GetListOfKeys()->At(0))->ReadObject<TList>();
-    int databin = usechilds ? 1 : b+1;
-    auto xsection = static_cast<TH1 *>(histos->FindObject("fHistXsection"))->GetBinContent(databin);
-    auto nTrials = static_cast<TH1 *>(histos->FindObject("fHistTrials"))->GetBinContent(databin);
-    auto nEvents = static_cast<TH1 *>(histos->FindObject("fHistEvents"))->GetBinContent(databin);
-    auto weight = xsection / nTrials;
-    Printf("weight: %e, xsec: %f mb, Events / trials: %f bin: %d", weight, xsection, nEvents/nTrials, b);
+  ROOT::EnableThreadSafety();
+  TStopwatch timer;
+  timer.Start();
+  std::string outputfilename = Form("%s_merged.root", treename.data());
+  auto getInputFile = [&](int b) -> TString {
+    return usechilds ? Form("%s/child_%d/%s", inputdir.data(), b, rootfile.data()) : Form("%s/%02d/%s", inputdir.data(), b, rootfile.data());
+  };
 
-    // Read tree, reweight
-    auto substructuretree = static_cast<TTree * >(filereader->Get(treename.data()));
-    if(substructuretree) std::cout << "Found substructuretree " << substructuretree->GetName() << " in file " << inputfile << std::endl;
-    TBranch *bWeightPtHard = substructuretree->Branch("PythiaWeight", &pythiaweight, "PythiaWeight/D");
-    for(auto en : ROOT::TSeqI(0, substructuretree->GetEntriesFast())){
-      //printf("Doing entry %d\n", en);
-      substructuretree->GetEntry(en);
-      pythiaweight = weight;
-      bWeightPtHard->Fill();
+  // Output schema, common for all workers
+  std::vector<std::string> schema;
+  bool writemask = false;
+  bool foundschema = false;
+  for(auto b : pthardbins) {
+    std::unique_ptr<TFile> schemareader(TFile::Open(getInputFile(b), "READ"));
+    if(!schemareader || schemareader->IsZombie()) continue;
+    auto schematree = schemareader->Get<TTree>(treename.data());
+    if(!schematree) continue;
+    schema = GetCopiedBranches(*schematree);
+    writemask = outliermask && schematree->GetLeaf("PtJetSim");
+    foundschema = true;
+    std::cout << "Output structure taken from pt-hard bin " << b << ": " << schema.size() << " branches copied" << (writemask ? ", with outlier mask" : "") << std::endl;
+    break;
+  }
+  if(!foundschema) {
+    std::cerr << "No readable input tree " << treename << " found in " << inputdir << std::endl;
+    return;
+  }
+
+  auto merger = std::make_unique<ROOT::Experimental::TBufferMerger>(outputfilename.data(), "RECREATE");
+
+  auto workitem = [&](int b) {
+    auto inputfile = getInputFile(b);
+    auto weight = weights.findBin(rootfile, dirname.Data(), b);
+    if(!weight) {
+      std::cerr << "No weight found for pt-hard bin " << b << ", skipping" << std::endl;
+      return;
     }
-    substructuretree->SetName(Form("jetSubstructure%d", b));
-    output->cd();
-    substructuretree->CloneTree(-1, "fast");
-    weighted.Add(substructuretree);
+    Printf("weight: %e, xsec: %f mb, Events / trials: %f bin: %d", weight->fWeight, weight->fXsection, weight->fEvents/weight->fTrials, b);
+
+    std::unique_ptr<TFile> filereader(TFile::Open(inputfile, "READ"));
+    if(!filereader || filereader->IsZombie()) {
+      std::cerr << "Failed reading " << inputfile << ", skipping pt-hard bin " << b << std::endl;
+      return;
+    }
+
+    auto substructuretree = static_cast<TTree *>(filereader->Get(treename.data()));
+    if(!substructuretree) {
+      std::cerr << "No tree " << treename << " in file " << inputfile << std::endl;
+      return;
+    }
+    std::cout << "Found substructuretree " << substructuretree->GetName() << " in file " << inputfile << std::endl;
+    if(GetCopiedBranches(*substructuretree) != schema) {
+      std::cerr << "Branches of " << treename << " in " << inputfile << " differ from the other pt-hard bins, skipping pt-hard bin " << b << std::endl;
+      return;
+    }
+
+    // Structure of the output tree taken from the input tree, the computed
+    // branches are not copied from the input
+    for(const auto &computed : kMergeComputedBranches) {
+      if(!substructuretree->GetBranch(computed.data())) continue;
+      if(computed == "PythiaWeight") std::cerr << "Pt-hard bin " << b << ": PythiaWeight in the input replaced by the weight from the catalogue" << std::endl;
+      substructuretree->SetBranchStatus(computed.data(), 0);
+    }
+    Double_t pythiaweight = weight->fWeight;
+    Int_t pthardbin = b;
+    auto outputfile = merger->GetFile();
+    outputfile->cd();
+    auto outputtree = substructuretree->CloneTree(0);
+    outputtree->SetName("jetSubstructureMerged");
+    outputtree->SetDirectory(outputfile.get());
+    outputtree->Branch("PythiaWeight", &pythiaweight, "PythiaWeight/D");
+    outputtree->Branch("PtHardBin", &pthardbin, "PtHardBin/I");
+    UChar_t outlier = 0;
+    auto ptsimleaf = substructuretree->GetLeaf("PtJetSim");
+    if(writemask) outputtree->Branch("OutlierMask", &outlier, "OutlierMask/b");
+
+    ScopedTimer bintimer(Form("pt-hard bin %d", b), "merge");
+    Long64_t nentries = substructuretree->GetEntries(); 
+    const Long64_t kMaskChunk = 4096;
+    std::vector<double> ptsimchunk;
+    std::vector<int> binchunk;
+    std::vector<UChar_t> maskchunk;
+    for(Long64_t chunkstart = 0; chunkstart < nentries; chunkstart += kMaskChunk) {
+      auto chunkend = std::min(chunkstart + kMaskChunk, nentries);
+      if(writemask) {
+        // masks of the chunk in one batch evaluation, only PtJetSim is read for it
+        auto nchunk = chunkend - chunkstart;
+        ptsimchunk.resize(nchunk);
+        binchunk.assign(nchunk, b);
+        maskchunk.resize(nchunk);
+        for(auto en : ROOT::TSeq<Long64_t>(chunkstart, chunkend)) {
+          ptsimleaf->GetBranch()->GetEntry(en);
+          ptsimchunk[en - chunkstart] = ptsimleaf->GetValue();
+        }
+        FillOutlierMasks(ptsimchunk.data(), binchunk.data(), nchunk, maskchunk.data());
+      }
+      for(auto en : ROOT::TSeq<Long64_t>(chunkstart, chunkend)){
+        substructuretree->GetEntry(en);
+        if(writemask) outlier = maskchunk[en - chunkstart];
+        outputtree->Fill();
+        if((en + 1) % flushentries == 0) outputfile->Write();
+      }
+    }
+    outputfile->Write();
+    outputtree->ResetBranchAddresses();
+    Instrumentation::Instance().AddCounter("entries merged", nentries);
+    Instrumentation::Instance().SampleMemory();
+    std::cout << "Pt-hard bin " << b << ": streamed " << nentries << " entries" << std::endl;
+  };
+
+  ROOT::TThreadExecutor pool(nthreads);
+  pool.Foreach(workitem, pthardbins);
+  merger.reset();     // output file is complete once the merger is destroyed
+  timer.Stop();
+  std::cout << "Merged " << pthardbins.size() << " pt-hard bins in " << timer.RealTime() << " s" << std::endl;
+
+  // min/max per cluster for the kinematic branches, used by range-aware readers
+  {
+    ScopedTimer zonemaptimer("zone map", "merge");
+    WriteZoneMap(outputfilename, "jetSubstructureMerged");
   }
-  std::cout << "Before merging\n";
-  
-  output->cd();
-  TTree *outputtree = TTree::MergeTrees(&weighted);
-  std::cout << "After merging\n";
-  outputtree->SetName("jetSubstructureMerged");
-  outputtree->Write();
+  Instrumentation::Instance().SampleBytesRead();
+  Instrumentation::Instance().WriteTrace(Form("%s_merged_trace.json", treename.data()));
 }
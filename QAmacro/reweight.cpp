@@ -10,6 +10,8 @@
 #include <TString.h>
 #endif
 
+#include "../helpers/pthardweights.C"
+
 void reweight(std::string_view filename = "AnalysisResults.root"){
   std::string outfilename(filename);
   outfilename = outfilename.substr(0, outfilename.find_last_of(".")) + "_scaled.root";
@@ -19,8 +21,9 @@ void reweight(std::string_view filename = "AnalysisResults.root"){
     if(TString(d->GetName()).Contains("PWG")){
       fread->cd(d->GetName());
       auto histlist = static_cast<TList *>(static_cast<TKey*>(gDirectory->GetListOfKeys()->At(0))->ReadObj());
-      double xsec = static_cast<TH1 *>(histlist->FindObject("fh1Xsec"))->GetBinContent(1), ntrials = static_cast<TH1 *>(histlist->FindObject("fh1Trials"))->GetBinContent(1);
-      auto weight = xsec / ntrials;
+      auto weightentry = GetPtHardWeightForFile(filename, d->GetName(), 0, 1, PtHardWeightHistogramsLegacy());
+      double xsec = weightentry.fXsection, ntrials = weightentry.fTrials;
+      auto weight = weightentry.fWeight;
       std::cout << "Using weight " << weight << " (xsec " << xsec << ", ntrials " << ntrials << ")" << std::endl;
 
       fwrite->mkdir(d->GetName());
@@ -8,7 +8,7 @@
 std::pair<TH2 *, TH2 *> getZLeadingDist(double R, bool data) {
     std::stringstream filename;
     filename <<  (data ? "data/merged_17" : "mc/merged_calo") << "/JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << int(R*10.) << "_" << (data ? "EJ1" : "INT7_merged") << ".root";
-    ROOT::RDataFrame specframe(GetNameJetSubstructureTree(filename.str()), filename.str());
+    auto specframe = GetJetSubstructureFrame(filename.str());
     std::vector<ROOT::RDF::RResultPtr<TH2D>> dists;
     if(!data) {
         const std::string weightbranch = "PythiaWeight";
@@ -0,0 +1,133 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <ROOT/TThreadExecutor.hxx>
+#include <RStringView.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
+#include <TSystem.h>
+#endif
+
+#include "FilterTree.cpp"
+#include "Spectrum/SpectrumTask/extractJetSpectrum.cpp"
+
+/**
+ * @brief Long-lived batch driver for the per-file macros
+ *
+ * Meant to be compiled once via ACLiC and reused by the steering scripts:
+ *
+ *   root -l -b -q 'batchProcess.cpp+("worklist.txt", 8)'
+ *
+ * ACLiC keeps the shared library (batchProcess_cpp.so) and its dictionary and module
+ * file next to the macro and rebuilds only if the sources changed, so the headers
+ * are not parsed and the macros are not JIT-compiled for every input file. Work items
+ * are processed on a thread pool within the same process.
+ *
+ * The work list contains one item per line: <task> <inputfile> [argument]
+ * Supported tasks:
+ * - filter: FilterTree (argument: pt cut)
+ * - spectrum: extractJetSpectrum (argument: trigger cluster)
+ * - noop: open and close the input file, used for the overhead benchmark
+ */
+struct WorkItem {
+  std::string fTask;
+  std::string fInputFile;
+  std::string fArgument;
+};
+
+std::vector<WorkItem> readWorkList(const std::string_view worklist) {
+  std::vector<WorkItem> result;
+  std::ifstream reader(worklist.data());
+  std::string line;
+  while(std::getline(reader, line)) {
+    line = trim(line);
+    if(!line.length() || line[0] == '#') continue;
+    std::stringstream decoder(line);
+    WorkItem item;
+    decoder >> item.fTask >> item.fInputFile >> item.fArgument;
+    result.emplace_back(item);
+  }
+  return result;
+}
+
+bool runWorkItem(const WorkItem &item) {
+  const std::map<std::string, std::function<void(const WorkItem &)>> tasks = {
+    {"filter", [](const WorkItem &w) { FilterTree(w.fInputFile, w.fArgument.length() ? std::stod(w.fArgument) : 10., "", 1); }},
+    {"spectrum", [](const WorkItem &w) { extractJetSpectrum(w.fInputFile, w.fArgument.length() ? std::stoi(w.fArgument) : 0); }},
+    {"noop", [](const WorkItem &w) { std::unique_ptr<TFile> reader(TFile::Open(w.fInputFile.data(), "READ")); }}
+  };
+  auto task = tasks.find(item.fTask);
+  if(task == tasks.end()) {
+    std::cerr << "Unknown task " << item.fTask << " for " << item.fInputFile << std::endl;
+    return false;
+  }
+  task->second(item);
+  return true;
+}
+
+/**
+ * Process all items of the work list on a thread pool
+ *
+ * @param worklist File with work items, one per line
+ * @param nthreads Number of parallel workers
+ * @return Wall time per item in seconds
+ */
+double batchProcess(const std::string_view worklist, int nthreads = 8) {
+  ROOT::EnableThreadSafety();
+  auto items = readWorkList(worklist);
+  if(!items.size()) {
+    std::cerr << "No work items in " << worklist << std::endl;
+    return 0.;
+  }
+  TStopwatch timer;
+  timer.Start();
+  ROOT::TThreadExecutor pool(std::min(nthreads, static_cast<int>(items.size())));
+  auto results = pool.Map([](const WorkItem &item) {
+    TStopwatch itemtimer;
+    itemtimer.Start();
+    auto status = runWorkItem(item);
+    itemtimer.Stop();
+    std::cout << "Processed " << item.fTask << " " << item.fInputFile << " in " << itemtimer.RealTime() << " s" << std::endl;
+    return status;
+  }, items);
+  timer.Stop();
+  auto nfailed = std::count(results.begin(), results.end(), false);
+  auto peritem = timer.RealTime() / items.size();
+  std::cout << "Processed " << items.size() << " items (" << nfailed << " failed) in " << timer.RealTime() << " s, " << peritem << " s/item" << std::endl;
+  return peritem;
+}
+
+/**
+ * Benchmark of the per-item overhead: the same work list is processed once with
+ * one interpreted ROOT session per item (as done by the steering scripts so far) and
+ * once in the compiled batch driver. Both run sequentially, use the noop task to
+ * measure the pure startup overhead:
+ *
+ *   root -l -b -q -e '.L batchProcess.cpp+' -e 'batchOverheadBenchmark("worklist.txt")'
+ */
+void batchOverheadBenchmark(const std::string_view worklist, const std::string_view task = "noop") {
+  std::map<std::string, std::string> macros = {{"filter", "FilterTree.cpp"}, {"spectrum", "Spectrum/SpectrumTask/extractJetSpectrum.cpp"}};
+  auto items = readWorkList(worklist);
+  std::ofstream benchmarklist("batchbenchmark_worklist.txt");
+  for(const auto &item : items) benchmarklist << task << " " << item.fInputFile << std::endl;
+  benchmarklist.close();
+
+  TStopwatch timer;
+  timer.Start();
+  for(const auto &item : items) {
+    if(task == "noop") gSystem->Exec(Form("root -l -b -q -e 'TFile::Open(\"%s\")' > /dev/null", item.fInputFile.data()));
+    else gSystem->Exec(Form("root -l -b -q '%s/%s(\"%s\")' > /dev/null", gSystem->DirName(__FILE__), macros[std::string(task)].data(), item.fInputFile.data()));
+  }
+  timer.Stop();
+  auto perprocess = timer.RealTime() / items.size();
+  auto perbatch = batchProcess("batchbenchmark_worklist.txt", 1);
+  std::cout << "Per-item time: " << perprocess << " s (one ROOT session per item), " << perbatch << " s (batch driver), overhead "
+            << perprocess - perbatch << " s/item" << std::endl;
+}
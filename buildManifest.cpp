@@ -0,0 +1,30 @@
+#ifndef __CLING__
+#include <iostream>
+#include <string>
+#include <RStringView.h>
+#include <TStopwatch.h>
+#endif
+
+#include "helpers/manifest.C"
+
+/**
+ * Build the manifest for a production directory
+ *
+ * All files are opened once and the jet substructure trees are recorded with
+ * file path, tree name, entries, branches, jet definition, period and pt-hard bin
+ * in <inputdir>/substructure_manifest.txt. Jobs resolving tree names and jet
+ * definitions via helpers/substructuretree.C use the manifest instead of scanning
+ * the file. Files modified after building the manifest are scanned as before.
+ *
+ * @param inputdir Production directory
+ * @param pattern File name pattern of the files to be recorded
+ */
+void buildManifest(const std::string_view inputdir = ".", const std::string_view pattern = "*.root") {
+  TStopwatch timer;
+  timer.Start();
+  auto manifest = BuildProductionManifest(inputdir, pattern);
+  std::string manifestfile = getRealPath(inputdir) + "/" + kManifestName;
+  manifest.write(manifestfile);
+  timer.Stop();
+  std::cout << "Written manifest " << manifestfile << " with " << manifest.entries().size() << " trees (" << timer.RealTime() << " s)" << std::endl;
+}
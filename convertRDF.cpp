@@ -1,22 +1,46 @@
 #include "meta/root.C"
+#include "helpers/pthard.C"
+#include "helpers/pthardweights.C"
 
-void convertRDF(const std::string_view filename, const std::string_view treename, int pthardbin){
-    ROOT::EnableImplicitMT(10);
-    std::unique_ptr<TFile> filereader(TFile::Open(filename.data(), "READ"));
-
+/**
+ * Attach pt-hard bin and pythia weight to the jet substructure tree of a pt-hard bin
+ *
+ * In friend mode (default) the input tree is not rewritten: derived per-entry columns
+ * (outlier mask OutlierMask, same encoding as in MergeResponseppNew, see helpers/pthard.C)
+ * go into a small friend tree aligned with the input tree, the per-file
+ * constants are stored as parameters in the user info of the friend tree. Read back with
+ * GetAugmentedJetSubstructureFrame, which provides the constants as columns and attaches
+ * the friend to the tree recorded in the user info ("sourcetree"). Without
+ * friend mode the full tree is copied with the two constant columns added.
+ */
+void convertRDF(const std::string_view filename, const std::string_view treename, int pthardbin, bool asfriend = true){
     std::string listname = std::string(treename);
     listname.erase(listname.find("Tree"), 4);
-    filereader->cd(listname.data());
-    auto histlist = static_cast<TKey *>(gDirectory->GetListOfKeys()->At(0))->ReadObject<TList>();
-    auto xsection = static_cast<TH1 *>(histlist->FindObject("fHistXsection"))->GetBinContent(pthardbin+1);
-    auto nTrials = static_cast<TH1 *>(histlist->FindObject("fHistTrials"))->GetBinContent(pthardbin+1);
-    auto nEvents = static_cast<TH1 *>(histlist->FindObject("fHistEvents"))->GetBinContent(pthardbin+1);
-    auto weightPythia  = xsection / nTrials;
+    auto weightPythia = GetPtHardWeightForFile(filename, listname, pthardbin, pthardbin+1).fWeight;
 
     std::cout << "Pt-hard bin " << pthardbin << "found weight " << weightPythia << std::endl;
     
+    if(!asfriend) {
+        ROOT::EnableImplicitMT(10);
+        ROOT::RDataFrame df(treename.data(), filename.data());
+        df.Define("pthardbin", [&pthardbin](){ return pthardbin; }, {})
+          .Define("weightPythiaFromPtHard", [&weightPythia](){return weightPythia;}, {})
+          .Snapshot("jetSubstructure", Form("%s_pt%02d.root", treename.data(), pthardbin));
+        return;
+    }
+
+    // no implicit MT: the entries of the friend tree must keep the order of the input tree
+    std::string friendfile = Form("%s_pt%02d_friend.root", treename.data(), pthardbin);
     ROOT::RDataFrame df(treename.data(), filename.data());
-    df.Define("pthardbin", [&pthardbin](){ return pthardbin; }, {})
-      .Define("weightPythiaFromPtHard", [&weightPythia](){return weightPythia;}, {})
-      .Snapshot("jetSubstructure", Form("%s_pt%02d.root", treename.data(), pthardbin));
-}
\ No newline at end of file
+    df.Define("OutlierMask", [pthardbin](double ptsim) { return GetOutlierMask(ptsim, pthardbin); }, {"PtJetSim"})
+      .Snapshot("jetSubstructureFriend", friendfile, {"OutlierMask"});
+
+    std::unique_ptr<TFile> friendwriter(TFile::Open(friendfile.data(), "UPDATE"));
+    auto friendtree = static_cast<TTree *>(friendwriter->Get("jetSubstructureFriend"));
+    friendtree->GetUserInfo()->Add(new TParameter<int>("pthardbin", pthardbin));
+    friendtree->GetUserInfo()->Add(new TParameter<double>("weightPythiaFromPtHard", weightPythia));
+    // tree the entries are aligned with, used by GetAugmentedJetSubstructureFrame
+    friendtree->GetUserInfo()->Add(new TNamed("sourcetree", treename.data()));
+    friendtree->Write("", TObject::kOverwrite);
+    std::cout << "Friend tree written to " << friendfile << std::endl;
+}
@@ -0,0 +1,85 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RNTupleImporter.hxx>
+#include <ROOT/TSeq.hxx>
+#include <RStringView.h>
+#include <RVersion.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
+#endif
+
+#include "helpers/filesystem.C"
+#include "helpers/substructuretree.C"
+
+/**
+ * Read benchmark as done in the spectrum extraction and unfolding jobs:
+ * fill the standard kinematic and zg histograms from the data frame
+ */
+double benchmarkFrame(ROOT::RDF::RNode frame) {
+  TStopwatch timer;
+  timer.Start();
+  auto hpt = frame.Histo1D({"ptrec", "ptrec", 300, 0., 300.}, "PtJetRec");
+  auto hzg = frame.Histo2D({"zgpt", "zgpt", 10, 0., 0.5, 30, 0., 300.}, "ZgMeasured", "PtJetRec");
+  *hpt;
+  timer.Stop();
+  return timer.RealTime();
+}
+
+/**
+ * Benchmark a file read from the storage: the file is evicted from the page
+ * cache before the data frame is built
+ */
+double benchmarkFile(const std::string_view filename) {
+  if(!dropPageCache(filename)) std::cerr << "Cannot evict " << filename << " from the page cache, read time may be biased" << std::endl;
+  return benchmarkFrame(GetJetSubstructureFrame(filename));
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+/**
+ * Convert a JetSubstructureTree_* file into RNTuple format and compare
+ * the read performance of both formats via RDataFrame
+ *
+ * The RNTuple gets the same name as the tree, so all readers resolving the
+ * name via GetNameJetSubstructureTree / GetJetSubstructureFrame consume both
+ * formats transparently.
+ *
+ * For the benchmark the reads alternate between TTree and RNTuple for nrepeat
+ * rounds, each read starting from an evicted page cache, the median read time
+ * is reported.
+ */
+void convertRNTuple(const std::string_view inputfile, bool benchmark = true, int nthreads = 8, int nrepeat = 3) {
+  auto treename = GetNameJetSubstructureTree(inputfile);
+  std::string outputfile(inputfile);
+  outputfile.erase(outputfile.find(".root"), 5);
+  outputfile += "_rntuple.root";
+
+  TStopwatch timer;
+  timer.Start();
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,30,0)
+  auto importer = ROOT::Experimental::RNTupleImporter::Create(inputfile, treename, outputfile).Unwrap();
+  importer->Import().ThrowOnError();
+#else
+  auto importer = ROOT::Experimental::RNTupleImporter::Create(inputfile, treename, outputfile);
+  importer->Import();
+#endif
+  timer.Stop();
+  std::cout << "Converted " << treename << " into RNTuple in " << outputfile << " (" << timer.RealTime() << " s)" << std::endl;
+
+  if(!benchmark) return;
+  if(nthreads > 1) ROOT::EnableImplicitMT(nthreads);
+  std::vector<double> timetree, timentuple;
+  for(auto irepeat : ROOT::TSeqI(0, std::max(nrepeat, 1))) {
+    timetree.emplace_back(benchmarkFile(inputfile));
+    timentuple.emplace_back(benchmarkFile(outputfile));
+  }
+  std::cout << "Read benchmark: TTree " << median(timetree) << " s, RNTuple " << median(timentuple) << " s" << std::endl;
+}
@@ -1,11 +1,216 @@
-void convertcompression(const std::string_view inputfile){
+#ifndef __CLING__
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <ROOT/TSeq.hxx>
+#include <RStringView.h>
+#include <Compression.h>
+#include <TBranch.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
+#include <TTree.h>
+#endif
+
+#include "helpers/filesystem.C"
+#include "helpers/root.C"
+#include "helpers/string.C"
+
+struct ReadBenchmark {
+  Long64_t fEntries;
+  double fMegabytes;
+  double fRealTime;
+
+  double entriesPerSecond() const { return fRealTime > 0 ? fEntries / fRealTime : 0.; }
+  double megabytesPerSecond() const { return fRealTime > 0 ? fMegabytes / fRealTime : 0.; }
+};
+
+/**
+ * Decode a compression setting of the form algorithm:level (i.e. lz4:4, zstd:5, lzma:8, zlib:1)
+ * into the ROOT compression settings (100 * algorithm + level). ROOT accepts
+ * levels 1-9 for all algorithms, -1 is returned for an invalid level.
+ */
+int decodeCompressionSetting(const std::string &setting) {
+  const std::map<std::string, int> algorithms = {{"zlib", 1}, {"lzma", 2}, {"lz4", 4}, {"zstd", 5}};
+  auto tokens = tokenize(trim(setting), ':');
+  auto alg = algorithms.find(tokens[0]);
+  if(alg == algorithms.end()) {
+    std::cerr << "Unknown compression algorithm " << tokens[0] << ", using zlib" << std::endl;
+    return 101;
+  }
+  int level = 1;
+  if(tokens.size() > 1) {
+    try {
+      size_t decoded = 0;
+      level = std::stoi(tokens[1], &decoded);
+      if(decoded != tokens[1].size()) level = -1;
+    } catch(std::exception &e) {
+      level = -1;
+    }
+  }
+  if(level < 1 || level > 9) {
+    std::cerr << "Invalid compression level in " << setting << ", levels must be within 1 and 9" << std::endl;
+    return -1;
+  }
+  return alg->second * 100 + level;
+}
+
+/**
+ * Decode the compression policy of the form "branch1,branch2=alg:level;*=alg:level".
+ * The wildcard entry applies to all branches not listed explicitly. An empty
+ * policy is returned if any of the settings is invalid.
+ */
+std::map<std::string, int> decodePolicy(const std::string &policy) {
+  std::map<std::string, int> result;
+  for(const auto &rule : tokenize(policy, ';')){
+    auto assignment = tokenize(rule, '=');
+    if(assignment.size() != 2) continue;
+    auto setting = decodeCompressionSetting(assignment[1]);
+    if(setting < 0) return {};
+    for(const auto &branch : tokenize(assignment[0], ',')) result[trim(branch)] = setting;
+  }
+  return result;
+}
+
+/**
+ * Set the compression of the branches and all their sub-branches. A sub-branch
+ * inherits the setting of its parent unless it is listed in the policy itself.
+ */
+void setBranchCompression(const std::string &treename, TObjArray *branches, const std::map<std::string, int> &settings, int inherited) {
+  for(auto b : TRangeDynCast<TBranch>(branches)){
+    if(!b) continue;
+    auto setting = settings.find(b->GetName());
+    int branchsetting = setting != settings.end() ? setting->second : inherited;
+    if(branchsetting >= 0) {
+      std::cout << "Tree " << treename << ": compressing branch " << b->GetName() << " with setting " << branchsetting << std::endl;
+      b->SetCompressionSettings(branchsetting);
+    }
+    setBranchCompression(treename, b->GetListOfBranches(), settings, branchsetting);
+  }
+}
+
+/**
+ * Rewrite the content of a directory and its subdirectories with the policy. Only the
+ * highest cycle of each key is written, the paths of the trees are added to trees.
+ */
+void recompressDirectory(TDirectory *in, TDirectory *out, const std::map<std::string, int> &settings, const std::string &path, std::vector<std::string> &trees) {
+  auto defaultsetting = settings.find("*");
+  for(auto k : GetLatestKeys(in)){
+    std::string classname = k->GetClassName();
+    if(classname == "TDirectoryFile" || classname == "TDirectory") {
+      recompressDirectory(in->GetDirectory(k->GetName()), out->mkdir(k->GetName()), settings, path + k->GetName() + "/", trees);
+      continue;
+    }
+    out->cd();
+    if(classname != "TTree") {
+      std::unique_ptr<TObject> obj(k->ReadObj());
+      obj->Write(k->GetName(), TObject::kSingleKey);
+      continue;
+    }
+    trees.emplace_back(path + k->GetName());
+    std::unique_ptr<TTree> intree(k->ReadObject<TTree>());
+    auto outtree = intree->CloneTree(0);
+    setBranchCompression(trees.back(), outtree->GetListOfBranches(), settings, defaultsetting != settings.end() ? defaultsetting->second : -1);
+    outtree->CopyEntries(intree.get());
+    outtree->Write();
+    std::cout << "Tree " << trees.back() << ": " << intree->GetZipBytes() << " -> " << outtree->GetZipBytes() << " bytes" << std::endl;
+  }
+}
+
+ReadBenchmark benchmarkRead(const std::string_view filename, const std::string_view treename, const std::vector<std::string> &branches) {
+  if(!dropPageCache(filename)) std::cerr << "Cannot evict " << filename << " from the page cache, read throughput may be biased" << std::endl;
+  std::unique_ptr<TFile> reader(TFile::Open(filename.data(), "READ"));
+  auto tree = static_cast<TTree *>(reader->Get(treename.data()));
+  tree->SetBranchStatus("*", 0);
+  for(const auto &b : branches) tree->SetBranchStatus(b.data(), 1);
+  tree->SetCacheSize(50 * 1024 * 1024);
+  for(const auto &b : branches) tree->AddBranchToCache(b.data(), true);
+  auto bytesbefore = reader->GetBytesRead();
+  TStopwatch timer;
+  timer.Start();
+  Long64_t nentries = tree->GetEntries();
+  for(auto en : ROOT::TSeq<Long64_t>(0, nentries)) tree->GetEntry(en);
+  timer.Stop();
+  return {nentries, static_cast<double>(reader->GetBytesRead() - bytesbefore) / (1024. * 1024.), timer.RealTime()};
+}
+
+/**
+ * Median of repeated read benchmarks (by real time)
+ */
+ReadBenchmark medianBenchmark(std::vector<ReadBenchmark> benchmarks) {
+  std::sort(benchmarks.begin(), benchmarks.end(), [](const ReadBenchmark &first, const ReadBenchmark &second) { return first.fRealTime < second.fRealTime; });
+  return benchmarks[benchmarks.size() / 2];
+}
+
+void printBenchmark(const std::string_view label, const ReadBenchmark &bench) {
+  std::cout << label << ": " << bench.fEntries << " entries in " << bench.fRealTime << " s - "
+            << bench.entriesPerSecond() << " entries/s, " << bench.megabytesPerSecond() << " MB/s" << std::endl;
+}
+
+/**
+ * Rewrite a file with new compression settings
+ *
+ * Without policy all keys are rewritten with ZLIB. With a policy trees are
+ * rewritten branch-by-branch with the compression settings from the policy,
+ * i.e. "PtJetRec,PtJetSim,PythiaWeight=lz4:4;*=zstd:5". Baskets are compressed
+ * in parallel (implicit MT). Subdirectories are rewritten recursively, for
+ * keys with several cycles only the highest cycle is written. The read
+ * throughput of the benchmark branches (default: branches listed explicitly
+ * in the policy) is measured for input and output, each file is evicted from
+ * the page cache before reading, and the reads alternate between input and
+ * output for nrepeat rounds. The median throughput is reported.
+ */
+void convertcompression(const std::string_view inputfile, const std::string_view policy = "", const std::string_view benchmarkbranches = "", int nthreads = 8, int nrepeat = 3){
     std::string outname = std::string(inputfile);
     outname.erase(outname.find(".root"),5);
-    outname += "_oldcompression.root";
-    std::unique_ptr<TFile> in(TFile::Open(inputfile.data(), "READ")),
-                           out(TFile::Open(outname.data(), "RECREATE"));
-    out->SetCompressionAlgorithm(ROOT::kZLIB);
-    out->cd();
-    for(auto k :*in->GetListOfKeys())
-        k->Write();
-}
\ No newline at end of file
+    if(!policy.length()) {
+        outname += "_oldcompression.root";
+        std::unique_ptr<TFile> in(TFile::Open(inputfile.data(), "READ")),
+                               out(TFile::Open(outname.data(), "RECREATE"));
+        out->SetCompressionAlgorithm(ROOT::kZLIB);
+        out->cd();
+        for(auto k :*in->GetListOfKeys())
+            k->Write();
+        return;
+    }
+
+    outname += "_recompressed.root";
+    auto settings = decodePolicy(std::string(policy));
+    if(!settings.size()) {
+        std::cerr << "No valid compression settings in policy " << policy << std::endl;
+        return;
+    }
+    auto defaultsetting = settings.find("*");
+    std::vector<std::string> benchbranches;
+    if(benchmarkbranches.length()) {
+        for(const auto &b : tokenize(std::string(benchmarkbranches), ',')) benchbranches.emplace_back(trim(b));
+    } else {
+        for(const auto &s : settings) if(s.first != "*") benchbranches.emplace_back(s.first);
+    }
+
+    std::vector<std::string> trees;
+    if(nthreads > 1) ROOT::EnableImplicitMT(nthreads);
+    {
+        std::unique_ptr<TFile> in(TFile::Open(inputfile.data(), "READ")),
+                               out(TFile::Open(outname.data(), "RECREATE"));
+        if(defaultsetting != settings.end()) out->SetCompressionSettings(defaultsetting->second);
+        recompressDirectory(in.get(), out.get(), settings, "", trees);
+    }
+
+    if(!benchbranches.size()) return;
+    for(const auto &t : trees) {
+        std::vector<ReadBenchmark> inputbench, outputbench;
+        for(auto irepeat : ROOT::TSeqI(0, std::max(nrepeat, 1))) {
+            inputbench.emplace_back(benchmarkRead(inputfile, t, benchbranches));
+            outputbench.emplace_back(benchmarkRead(outname, t, benchbranches));
+        }
+        printBenchmark(Form("%s (input)", t.data()), medianBenchmark(inputbench));
+        printBenchmark(Form("%s (recompressed)", t.data()), medianBenchmark(outputbench));
+    }
+}
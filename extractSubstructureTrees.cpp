@@ -1,36 +1,62 @@
 #ifndef __CLING__
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+#include <ROOT/TThreadExecutor.hxx>
 #include <RStringView.h>
 #include <TFile.h>
 #include <TKey.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
 #include <TTree.h>
 #include <TString.h>
 #endif
 
-void store_tree(TTree *t){
-  std::string fname = t->GetName();
-  fname += ".root";
+#include "helpers/root.C"
+
+void store_tree(const std::string &infilename, const std::string &treename){
+  std::string fname = treename + ".root";
   std::cout  << "Storing tree under file " << fname << std::endl;
 
+  TStopwatch timer;
+  timer.Start();
+  std::unique_ptr<TFile> reader(TFile::Open(infilename.data(), "READ"));
+  auto t = static_cast<TTree *>(reader->Get(treename.data()));
   std::unique_ptr<TFile> writer(TFile::Open(fname.data(), "RECREATE"));
   writer->cd();
-  auto ctree = t->CloneTree();
+  // fast cloning: baskets are copied without decompression / recompression
+  auto ctree = t->CloneTree(-1, "fast");
   ctree->SetName("jetSubstructure");
   ctree->Write();
+  timer.Stop();
+  std::cout << "Tree " << treename << ": " << t->GetEntries() << " entries, " << t->GetZipBytes() << " bytes ("
+            << t->GetTotBytes() << " uncompressed) in " << timer.RealTime() << " s" << std::endl;
 }
 
-void extractSubstructureTrees(std::string_view infilename = "AnalysisResults.root"){
-  std::unique_ptr<TFile> reader(TFile::Open(infilename.data(), "READ"));
-  for(auto k : TRangeDynCast<TKey>(reader->GetListOfKeys())){
-    if(!k) continue;
-    std::cout << "Found " << k->GetName() << std::endl;
-    TObject *o = static_cast<TKey *>(k)->ReadObj();
-    if(o->IsA() == TTree::Class()) std::cout << "Object is a tree with name " << o->GetName() << std::endl; 
-    if((o->IsA() == TTree::Class()) && (TString(o->GetName()).Contains("JetSubstructure"))){
-      std::cout << "Found substructure tree" << std::endl;
-      store_tree(static_cast<TTree *>(o));
+void extractSubstructureTrees(std::string_view infilename = "AnalysisResults.root", int nthreads = 4){
+  std::vector<std::string> trees;
+  {
+    std::unique_ptr<TFile> reader(TFile::Open(infilename.data(), "READ"));
+    // highest cycle per name only, otherwise several jobs would write the same output file
+    for(auto k : GetLatestKeys(reader.get())){
+      std::cout << "Found " << k->GetName() << std::endl;
+      // Select on the class name stored in the key, the tree itself is not read
+      if((std::string(k->GetClassName()) == "TTree") && (TString(k->GetName()).Contains("JetSubstructure"))){
+        std::cout << "Found substructure tree " << k->GetName() << std::endl;
+        trees.emplace_back(k->GetName());
+      }
     }
   }
-}
\ No newline at end of file
+  if(!trees.size()) return;
+
+  ROOT::EnableThreadSafety();
+  TStopwatch timer;
+  timer.Start();
+  std::string infile(infilename);
+  ROOT::TThreadExecutor pool(std::min(nthreads, static_cast<int>(trees.size())));
+  pool.Foreach([&infile](const std::string &treename) { store_tree(infile, treename); }, trees);
+  timer.Stop();
+  std::cout << "Extracted " << trees.size() << " trees in " << timer.RealTime() << " s" << std::endl;
+}
@@ -1,29 +1,90 @@
 #ifndef __CLING__
 #include <algorithm>
+#include <iostream>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include <ROOT/TSeq.hxx>
 #include <RStringView.h>
+#include <TBranch.h>
 #include <TFile.h>
 #include <TGraph.h>
+#include <TStopwatch.h>
 #include <TTree.h>
-#include <TTreeReader.h>
 #endif
 
-void extractWeightsFromTree(const std::string_view filename){
-  std::vector<double> weights;
-  std::unique_ptr<TFile> reader(TFile::Open(filename.data(), "READ"));
-  TTreeReader tr(static_cast<TTree*>(reader->Get("jetSubstructureMerged")));
-  TTreeReaderValue<double> weight(tr, "PythiaWeight");
-  for(auto en : tr){
-    if(std::find(weights.begin(), weights.end(), *weight) == weights.end()) weights.push_back(*weight);
+struct WeightStat {
+  double fWeight;
+  Long64_t fEntries;
+  double fSumWeights;
+};
+
+/**
+ * Collect the distinct pythia weights of a merged tree
+ *
+ * Only the PythiaWeight branch is read. Distinct weights are collected in a hash map
+ * together with the number of entries and the sum of weights. The result is stored next
+ * to the merged file (<merged>_weights.root) as graph and as small tree for the pt-hard QA.
+ */
+void extractWeightsFromTree(const std::string_view filename, const std::string_view treename = "jetSubstructureMerged"){
+  std::unordered_map<double, WeightStat> weightmap;
+  TStopwatch timer;
+  timer.Start();
+  Long64_t nentries = 0;
+  {
+    std::unique_ptr<TFile> reader(TFile::Open(filename.data(), "READ"));
+    auto tree = static_cast<TTree*>(reader->Get(treename.data()));
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("PythiaWeight", 1);
+    auto weightbranch = tree->GetBranch("PythiaWeight");
+    double weight(0.);
+    weightbranch->SetAddress(&weight);
+    tree->SetCacheSize(10 * 1024 * 1024);
+    tree->AddBranchToCache(weightbranch, true);
+    nentries = tree->GetEntries();
+    for(auto en : ROOT::TSeq<Long64_t>(0, nentries)){
+      tree->LoadTree(en);
+      weightbranch->GetEntry(en);
+      auto found = weightmap.find(weight);
+      if(found == weightmap.end()) {
+        weightmap.insert({weight, {weight, 1, weight}});
+      } else {
+        found->second.fEntries++;
+        found->second.fSumWeights += weight;
+      }
+    }
+    tree->ResetBranchAddresses();
   }
-  std::sort(weights.begin(), weights.end(), std::greater<double>());
+  timer.Stop();
+
+  std::vector<WeightStat> weights;
+  for(const auto &w : weightmap) weights.emplace_back(w.second);
+  std::sort(weights.begin(), weights.end(), [](const WeightStat &first, const WeightStat &second) { return first.fWeight > second.fWeight; });
+  std::cout << "Found " << weights.size() << " distinct weights in " << nentries << " entries (" << timer.RealTime() << " s)" << std::endl;
 
   auto graph = new TGraph(weights.size());
-  for(auto ien : ROOT::TSeqI(0, weights.size())) graph->SetPoint(ien, ien+1, weights[ien]);
+  for(auto ien : ROOT::TSeqI(0, weights.size())) {
+    graph->SetPoint(ien, ien+1, weights[ien].fWeight);
+    std::cout << "Weight " << weights[ien].fWeight << ": " << weights[ien].fEntries << " entries, sum of weights " << weights[ien].fSumWeights << std::endl;
+  }
   graph->SetMarkerStyle(24);
   graph->Draw("ap");
-  std::unique_ptr<TFile> weightfile(TFile::Open("weights.root", "RECREATE"));
+
+  std::string outfilename(filename);
+  outfilename = outfilename.substr(0, outfilename.find_last_of(".")) + "_weights.root";
+  std::unique_ptr<TFile> weightfile(TFile::Open(outfilename.data(), "RECREATE"));
   weightfile->cd();
   graph->Write("weights");
-}
\ No newline at end of file
+  WeightStat current;
+  auto weighttree = new TTree("weightindex", "Distinct pythia weights");
+  weighttree->Branch("Weight", &current.fWeight, "Weight/D");
+  weighttree->Branch("Entries", &current.fEntries, "Entries/L");
+  weighttree->Branch("SumWeights", &current.fSumWeights, "SumWeights/D");
+  for(const auto &w : weights) {
+    current = w;
+    weighttree->Fill();
+  }
+  weighttree->Write();
+  std::cout << "Weight index written to " << outfilename << std::endl;
+}
@@ -0,0 +1,194 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+#include <RStringView.h>
+#include <TFileMerger.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
+#include <TSystem.h>
+#endif
+
+#include "helpers/filesystem.C"
+#include "helpers/manifest.C"
+#include "helpers/string.C"
+
+/**
+ * @brief Node of the merge DAG
+ *
+ * Inputs are either the per-period files (period -> year) or the outputs
+ * of other nodes (year -> multi-year). Nodes on the same level are independent
+ * and are merged in parallel.
+ */
+struct MergeNode {
+  std::string fOutputFile;
+  std::vector<std::string> fInputFiles;
+  int fLevel;
+};
+
+std::vector<std::string> findPeriodFiles(const std::string_view basedir, const std::string_view filename, int year) {
+  std::vector<std::string> result;
+  TString filelist = gSystem->GetFromPipe(Form("find %s -name \"%s\"", basedir.data(), filename.data()));
+  std::unique_ptr<TObjArray> files(filelist.Tokenize("\n"));
+  for(auto f : TRangeDynCast<TObjString>(files.get())) {
+    if(!f) continue;
+    std::string path = f->String().Data();
+    // selection on the path below basedir, basedir itself may contain merged_ or the period
+    auto relpath = path.find(basedir) == 0 ? path.substr(basedir.length()) : path;
+    if(contains(relpath, "merged_")) continue;
+    if(contains(relpath, Form("LHC%d", year))) result.emplace_back(path);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/**
+ * State of the inputs of a node: one line per input file with path, size and
+ * modification time (tab-separated), stored in <output>.inputs after a successful
+ * merge (as done by mergeMCPtHardDatasets.py)
+ */
+std::string getInputState(const MergeNode &node) {
+  std::stringstream state;
+  for(const auto &f : node.fInputFiles) {
+    Long_t id, flags, modtime;
+    Long64_t size;
+    if(gSystem->GetPathInfo(f.data(), &id, &size, &flags, &modtime)) size = modtime = -1;
+    state << f << "\t" << size << "\t" << modtime << "\n";
+  }
+  return state.str();
+}
+
+std::string getInputStateFile(const MergeNode &node) {
+  return node.fOutputFile + ".inputs";
+}
+
+/**
+ * Output is up to date if it exists and was merged from the same set of
+ * inputs, unchanged since (added, removed or replaced inputs are detected)
+ */
+bool isUpToDate(const MergeNode &node) {
+  if(getModTime(node.fOutputFile) < 0) return false;
+  std::ifstream reader(getInputStateFile(node));
+  if(!reader.is_open()) return false;
+  std::stringstream recorded;
+  recorded << reader.rdbuf();
+  return recorded.str() == getInputState(node);
+}
+
+bool runMerge(const MergeNode &node) {
+  if(!node.fInputFiles.size()) {
+    std::cerr << "No input files for " << node.fOutputFile << std::endl;
+    return false;
+  }
+  if(isUpToDate(node)) {
+    std::cout << "Reusing " << node.fOutputFile << std::endl;
+    return true;
+  }
+  gSystem->mkdir(dirname(node.fOutputFile).data(), true);
+  auto inputstate = getInputState(node);
+  gSystem->Unlink(getInputStateFile(node).data());
+  TStopwatch timer;
+  timer.Start();
+  // trees and histograms are merged by the same merger (as hadd does)
+  TFileMerger merger(false, false);
+  merger.SetPrintLevel(0);
+  merger.OutputFile(node.fOutputFile.data(), "RECREATE");
+  for(const auto &f : node.fInputFiles) merger.AddFile(f.data(), false);
+  auto status = merger.Merge();
+  timer.Stop();
+  std::cout << "Merged " << node.fInputFiles.size() << " files into " << node.fOutputFile << " (" << timer.RealTime() << " s)" << std::endl;
+  if(status) {
+    std::ofstream writer(getInputStateFile(node));
+    writer << inputstate;
+  }
+  return status;
+}
+
+/**
+ * Build the merge DAG for a file: one node per year combining the per-period
+ * files, and a multi-year node combining the merged years
+ */
+std::vector<MergeNode> buildMergeDAG(const std::string_view basedir, const std::string_view filename, const std::vector<int> &years) {
+  std::vector<MergeNode> nodes;
+  std::vector<std::string> yearoutputs;
+  for(auto year : years) {
+    MergeNode node{Form("%s/merged_%d/%s", basedir.data(), year, filename.data()), findPeriodFiles(basedir, filename, year), 0};
+    yearoutputs.emplace_back(node.fOutputFile);
+    nodes.emplace_back(node);
+  }
+  if(years.size() > 1) {
+    std::string tag;
+    for(auto year : years) tag += std::to_string(year);
+    nodes.push_back({Form("%s/merged_%s/%s", basedir.data(), tag.data(), filename.data()), yearoutputs, 1});
+  }
+  return nodes;
+}
+
+/**
+ * Merge jet substructure trees and histogram files per year and over years
+ *
+ * Independent merges (all files and years on the same level of the DAG) run
+ * concurrently in one process. The multi-year files are built from the merged
+ * years instead of the per-period files. Outputs whose recorded inputs are
+ * unchanged (see isUpToDate) are reused, so reruns only merge what changed.
+ * Nodes depending on a failed merge are skipped.
+ *
+ * @param basedir Directory containing the per-period outputs (LHC16*, LHC17*, ...)
+ * @param jettype Jet type
+ * @param nworkers Number of parallel merges
+ */
+void mergeHierarchical(const std::string_view basedir = ".", const std::string_view jettype = "FullJets", int nworkers = 8) {
+  ROOT::EnableThreadSafety();
+  std::string inputdir = getRealPath(basedir);
+  std::vector<MergeNode> nodes;
+  for(const auto &trg : std::vector<std::string>{"INT7", "EJ1", "EJ2"}) {
+    std::vector<int> years = {17};
+    if(trg == "INT7") years.insert(years.begin(), 16);
+    for(auto r : ROOT::TSeqI(2, 6)) {
+      auto dag = buildMergeDAG(inputdir, Form("JetSubstructureTree_%s_R%02d_%s.root", jettype.data(), r, trg.data()), years);
+      nodes.insert(nodes.end(), dag.begin(), dag.end());
+    }
+  }
+  auto dag = buildMergeDAG(inputdir, "AnalysisResults_split.root", {16, 17});
+  nodes.insert(nodes.end(), dag.begin(), dag.end());
+
+  TStopwatch timer;
+  timer.Start();
+  ROOT::TThreadExecutor pool(nworkers);
+  int maxlevel = 0, nfailed = 0;
+  std::set<std::string> failed;
+  for(const auto &n : nodes) maxlevel = std::max(maxlevel, n.fLevel);
+  for(auto level : ROOT::TSeqI(0, maxlevel + 1)) {
+    std::vector<MergeNode> levelnodes;
+    for(const auto &n : nodes) {
+      if(n.fLevel != level) continue;
+      // nodes depending on a failed merge are not run, they would merge a stale or missing input
+      auto failedinput = std::find_if(n.fInputFiles.begin(), n.fInputFiles.end(), [&failed](const std::string &f) { return failed.count(f); });
+      if(failedinput != n.fInputFiles.end()) {
+        std::cerr << "Skipping " << n.fOutputFile << ": merge of input " << *failedinput << " failed" << std::endl;
+        failed.insert(n.fOutputFile);
+        nfailed++;
+        continue;
+      }
+      levelnodes.emplace_back(n);
+    }
+    if(!levelnodes.size()) continue;
+    auto results = pool.Map(runMerge, levelnodes);
+    for(auto i : ROOT::TSeqI(0, levelnodes.size())) {
+      if(results[i]) continue;
+      failed.insert(levelnodes[i].fOutputFile);
+      nfailed++;
+    }
+  }
+  timer.Stop();
+  std::cout << "Merged " << nodes.size() << " outputs (" << nfailed << " failed) in " << timer.RealTime() << " s" << std::endl;
+}
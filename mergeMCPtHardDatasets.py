@@ -2,6 +2,8 @@
 
 from __future__ import print_function
 import argparse
+import hashlib
+import json
 import logging
 import multiprocessing
 import os
@@ -29,16 +31,49 @@ class PtHardBin:
     def addfile(self, file):
         self.__files.append(file)
 
-    def merge(self, outputdir, basename):
+    def getfilestate(self):
+        # files are identified by path, size and modification time
+        state = {}
+        for f in self.__files:
+            info = os.stat(f)
+            state[f] = "%d:%d" %(info.st_size, int(info.st_mtime))
+        return state
+
+    def merge(self, outputdir, basename, incremental = True):
         outputfile = os.path.join(outputdir, "%02d" %self.__binid, basename)
         if not os.path.exists(os.path.dirname(outputfile)):
-            os.makedirs(os.path.dirname(outputfile), 0755)
-        command = ["hadd", "-f", outputfile]
-        for f in self.__files:
+            os.makedirs(os.path.dirname(outputfile), 0o755)
+        statefile = "%s.inputs" %outputfile
+        currentstate = self.getfilestate()
+        currenthash = hashlib.sha1(json.dumps(currentstate, sort_keys = True).encode()).hexdigest()
+        newfiles = sorted(self.__files)
+        append = False
+        if incremental and os.path.exists(outputfile) and os.path.exists(statefile):
+            with open(statefile) as reader:
+                oldstate = json.load(reader)
+            if oldstate["hash"] == currenthash:
+                logging.info("Pt-hard bin %d: inputs unchanged, keeping %s", self.__binid, outputfile)
+                return
+            oldfiles = oldstate["files"]
+            unchanged = all(f in currentstate and currentstate[f] == oldfiles[f] for f in oldfiles)
+            if unchanged:
+                # only new files - append them to the existing output
+                newfiles = sorted([f for f in currentstate if not f in oldfiles])
+                append = True
+                logging.info("Pt-hard bin %d: appending %d new files to %s", self.__binid, len(newfiles), outputfile)
+            else:
+                logging.info("Pt-hard bin %d: inputs modified or removed, rebuilding %s", self.__binid, outputfile)
+        command = ["hadd", "-a" if append else "-f", outputfile]
+        for f in newfiles:
             command.append(f)
         try:
             result = subprocess.call(command)
             logging.debug("Merge process finished with return code %d", result)
+            if result == 0:
+                with open(statefile, "w") as writer:
+                    json.dump({"hash": currenthash, "files": currentstate}, writer, indent = 1, sort_keys = True)
+            elif os.path.exists(statefile):
+                os.remove(statefile)
         except OSError as e:
             logging.error("Failed spawning merge process")
 
@@ -66,8 +101,9 @@ class Workqueue:
 
 class Merger(threading.Thread):
 
-    def __init__(self, workerID, outputdir, basename, workqueue):
+    def __init__(self, workerID, outputdir, basename, workqueue, incremental):
         threading.Thread.__init__(self)
+        self.__incremental = incremental
         self.__workerID = workerID
         self.__workqueue = workqueue
         self.__outputdir = outputdir
@@ -80,10 +116,10 @@ class Merger(threading.Thread):
             if not nextbin:
                 break
             logging.info("Worker %d: Merging pt-hard bin %d", self.__workerID, nextbin.getbinnumber())
-            nextbin.merge(self.__outputdir, self.__basename)
+            nextbin.merge(self.__outputdir, self.__basename, self.__incremental)
         logging.info("Worker %d: Finished work", self.__workerID)
 
-def mergemcptharddatasets(inputdir, basename, mergedir, nworkrequest):
+def mergemcptharddatasets(inputdir, basename, mergedir, nworkrequest, incremental = True):
     pthardbins = [] 
 
     logging.info("Base file: %s" %basename)
@@ -129,7 +165,7 @@ def mergemcptharddatasets(inputdir, basename, mergedir, nworkrequest):
     for wid in range(0, nworkersused):
         logging.info("Starting merger %d", wid)
         #continue
-        merger = Merger(wid, outputdir, basename, workqueue)
+        merger = Merger(wid, outputdir, basename, workqueue, incremental)
         merger.start()
         workers.append(merger)
   
@@ -145,5 +181,6 @@ if __name__ == "__main__":
     parser.add_argument("-f" , "--file", type = str, default = "AnalysisResults.root", help = "ROOT file to be merged (default: AnalysisResults.root)")
     parser.add_argument("-m", "--mergedir", type = str, default = "merged", help = "Directory of the period-merged output (default: merged)")
     parser.add_argument("-n", "--nworkers", type = int, default = multiprocessing.cpu_count(), help = "Number of parallel workers")
+    parser.add_argument("--full", action = "store_true", help = "Re-merge all pt-hard bins, ignoring the recorded input state")
     args = parser.parse_args()
-    mergemcptharddatasets(args.basedir, args.file, args.mergedir, args.nworkers)
+    mergemcptharddatasets(args.basedir, args.file, args.mergedir, args.nworkers, not args.full)
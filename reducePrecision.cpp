@@ -0,0 +1,170 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/TSeq.hxx>
+#include <RStringView.h>
+#include <TFile.h>
+#include <TH2D.h>
+#include <TKey.h>
+#include <TLeaf.h>
+#include <TROOT.h>
+#include <TTree.h>
+#endif
+
+#include "helpers/manifest.C"
+#include "helpers/root.C"
+#include "helpers/string.C"
+#include "unfolding/binnings/binningZg.C"
+
+/**
+ * Leaf type code of the leaflist for a given type name. Double32_t and Float16_t
+ * are kept in memory as double and float, only the on-disk representation differs.
+ */
+char getLeafTypeCode(const std::string &typname) {
+  const std::map<std::string, char> codes = {{"Double_t", 'D'}, {"Float_t", 'F'}, {"Int_t", 'I'}, {"UInt_t", 'i'}, {"Long64_t", 'L'},
+                                             {"ULong64_t", 'l'}, {"Short_t", 'S'}, {"UShort_t", 's'}, {"Char_t", 'B'}, {"UChar_t", 'b'},
+                                             {"Bool_t", 'O'}, {"Double32_t", 'd'}, {"Float16_t", 'f'}};
+  auto found = codes.find(typname);
+  return found == codes.end() ? 0 : found->second;
+}
+
+int findbin(const std::vector<double> &binning, double value) {
+  if(value < binning.front() || value >= binning.back()) return -1;
+  return std::upper_bound(binning.begin(), binning.end(), value) - binning.begin() - 1;
+}
+
+/**
+ * Fill the zg/pt histograms used in the unfolding: smeared, true (if
+ * available) and the flattened response matrix (if available)
+ */
+std::vector<TH2 *> fillZgResponse(const std::string_view filename, const std::string_view treename, const std::string_view tag, const std::string_view trigger) {
+  auto zgbinning = getZgBinningFine(), ptsmear = getPtBinningRealistic(trigger), pttrue = getPtBinningPart(trigger);
+  int nzg = zgbinning.size() - 1, nsmear = nzg * (ptsmear.size() - 1), ntrue = nzg * (pttrue.size() - 1);
+  ROOT::RDataFrame df(treename, filename);
+  ROOT::RDF::RNode weighted = df.HasColumn("PythiaWeight") ? df.Define("weight", "PythiaWeight") : df.Define("weight", [](){ return 1.; }, {});
+  std::vector<ROOT::RDF::RResultPtr<TH2D>> hists;
+  hists.emplace_back(weighted.Histo2D({Form("smeared_%s", tag.data()), "smeared", nzg, zgbinning.data(), static_cast<int>(ptsmear.size()-1), ptsmear.data()}, "ZgMeasured", "PtJetRec", "weight"));
+  if(df.HasColumn("ZgTrue") && df.HasColumn("PtJetSim")) {
+    hists.emplace_back(weighted.Histo2D({Form("true_%s", tag.data()), "true", nzg, zgbinning.data(), static_cast<int>(pttrue.size()-1), pttrue.data()}, "ZgTrue", "PtJetSim", "weight"));
+    auto flattened = weighted.Define("indexsmear", [zgbinning, ptsmear](double zg, double pt) {
+                                        auto zgbin = findbin(zgbinning, zg), ptbin = findbin(ptsmear, pt);
+                                        return (zgbin < 0 || ptbin < 0) ? -1. : static_cast<double>(zgbin + (zgbinning.size()-1) * ptbin);
+                                      }, {"ZgMeasured", "PtJetRec"})
+                             .Define("indextrue", [zgbinning, pttrue](double zg, double pt) {
+                                        auto zgbin = findbin(zgbinning, zg), ptbin = findbin(pttrue, pt);
+                                        return (zgbin < 0 || ptbin < 0) ? -1. : static_cast<double>(zgbin + (zgbinning.size()-1) * ptbin);
+                                      }, {"ZgTrue", "PtJetSim"});
+    hists.emplace_back(flattened.Histo2D({Form("response_%s", tag.data()), "response", nsmear, 0., static_cast<double>(nsmear), ntrue, 0., static_cast<double>(ntrue)}, "indexsmear", "indextrue", "weight"));
+  }
+  std::vector<TH2 *> result;
+  for(auto &h : hists) {
+    auto hist = static_cast<TH2 *>(histcopy(h.GetPtr()));
+    hist->SetDirectory(nullptr);
+    result.emplace_back(hist);
+  }
+  return result;
+}
+
+/**
+ * Validate the reduced-precision file against the original: the standard zg/pt
+ * histograms and the response matrix are filled from both files and the maximum
+ * absolute and relative bin-level difference is reported.
+ */
+void validatePrecision(const std::string_view inputfile, const std::string_view outputfile, const std::string_view treename, const std::string_view trigger = "INT7") {
+  auto reference = fillZgResponse(inputfile, treename, "reference", trigger),
+       reduced = fillZgResponse(outputfile, treename, "reduced", trigger);
+  for(auto ih : ROOT::TSeqI(0, reference.size())) {
+    double maxabs = 0., maxrel = 0.;
+    auto ref = reference[ih], red = reduced[ih];
+    for(auto bx : ROOT::TSeqI(0, ref->GetXaxis()->GetNbins())) {
+      for(auto by : ROOT::TSeqI(0, ref->GetYaxis()->GetNbins())) {
+        auto refval = ref->GetBinContent(bx+1, by+1), diff = std::abs(red->GetBinContent(bx+1, by+1) - refval);
+        maxabs = std::max(maxabs, diff);
+        if(refval != 0.) maxrel = std::max(maxrel, diff / std::abs(refval));
+      }
+    }
+    std::string name = ref->GetName();
+    name.erase(name.find("_reference"));
+    std::cout << "Validation " << name << ": max. abs. difference " << maxabs << ", max. rel. difference " << maxrel << std::endl;
+  }
+}
+
+/**
+ * Convert a jet substructure tree into reduced-precision storage
+ *
+ * Selected double branches are stored as Double32_t: with mantissabits = 0 they
+ * are stored as float, otherwise as truncated float with the given number of
+ * mantissa bits. In memory they stay double, so all readers (TTreeReaderValue<double>,
+ * RDataFrame) are unchanged. After the conversion the file is validated against the
+ * original using the zg/pt response matrices.
+ *
+ * @param inputfile File with the jet substructure tree
+ * @param branches Branches to be stored with reduced precision, separated by ","
+ * @param mantissabits Number of mantissa bits (0: float precision)
+ * @param trigger Trigger defining the pt binning for the validation
+ */
+void reducePrecision(const std::string_view inputfile, const std::string_view branches = "ZgMeasured,ZgTrue,RgMeasured,RgTrue,NEFRec,NEFSim,EtaRec,EtaSim,PhiRec,PhiSim,AreaRec,AreaSim", int mantissabits = 0, const std::string_view trigger = "INT7") {
+  std::vector<std::string> reduced;
+  for(const auto &b : tokenize(std::string(branches), ',')) reduced.emplace_back(trim(b));
+  std::string outputfile = std::string(inputfile);
+  outputfile.erase(outputfile.find(".root"), 5);
+  outputfile += "_reduced.root";
+
+  std::string treename;
+  {
+    std::unique_ptr<TFile> reader(TFile::Open(inputfile.data(), "READ")),
+                           writer(TFile::Open(outputfile.data(), "RECREATE"));
+    TTree *intree(nullptr);
+    if(auto treekey = FindJetSubstructureKey(*reader)) {
+      treename = treekey->GetName();
+      intree = treekey->ReadObject<TTree>();
+    }
+    if(!intree) {
+      std::cerr << "No jet substructure tree found in " << inputfile << std::endl;
+      return;
+    }
+    writer->cd();
+    auto outtree = new TTree(intree->GetName(), intree->GetTitle());
+    // one buffer per branch, sized from the leaf type and shared between input and output tree
+    std::vector<std::unique_ptr<Long64_t[]>> buffers;
+    for(auto b : TRangeDynCast<TBranch>(intree->GetListOfBranches())) {
+      if(!b) continue;
+      auto leaf = static_cast<TLeaf *>(b->GetListOfLeaves()->At(0));
+      if(b->GetListOfLeaves()->GetEntries() != 1 || leaf->GetLen() != 1 || !getLeafTypeCode(leaf->GetTypeName())) {
+        std::cerr << "Skipping branch " << b->GetName() << " - only single-value leaves are supported" << std::endl;
+        intree->SetBranchStatus(b->GetName(), 0);
+        continue;
+      }
+      auto typecode = getLeafTypeCode(leaf->GetTypeName());
+      std::string leaflist = std::string(b->GetName()) + "/" + typecode;
+      if(typecode == 'D' && std::find(reduced.begin(), reduced.end(), b->GetName()) != reduced.end()) {
+        leaflist = mantissabits ? Form("%s/d[0,0,%d]", b->GetName(), mantissabits) : Form("%s/d", b->GetName());
+        std::cout << "Storing " << b->GetName() << " with reduced precision (" << leaflist << ")" << std::endl;
+      }
+      buffers.emplace_back(new Long64_t[(leaf->GetLenType() + sizeof(Long64_t) - 1) / sizeof(Long64_t)]());
+      // untyped address: the buffer is interpreted with the type of the leaf
+      void *address = buffers.back().get();
+      auto status = intree->SetBranchAddress(b->GetName(), address);
+      if(status < 0) {
+        std::cerr << "Cannot set address of branch " << b->GetName() << " (status " << status << ")" << std::endl;
+        return;
+      }
+      outtree->Branch(b->GetName(), address, leaflist.data());
+    }
+    for(auto en : ROOT::TSeq<Long64_t>(0, intree->GetEntries())) {
+      intree->GetEntry(en);
+      outtree->Fill();
+    }
+    outtree->Write();
+    std::cout << "Tree " << treename << ": " << intree->GetZipBytes() << " -> " << outtree->GetZipBytes() << " bytes on disk" << std::endl;
+    intree->ResetBranchAddresses();
+  }
+
+  validatePrecision(inputfile, outputfile, treename, trigger);
+}
@@ -12,16 +12,16 @@ def find_files(inputdir, rootfilename):
         files.append(os.path.join(r,l))
   return sorted(files)
 
-def main(inputdir, rootfile):
-  script=os.path.join(os.path.abspath(os.path.dirname(sys.argv[0])), "FilterTree.cpp")
-  base = os.getcwd()
-  print("IAMHERE")
-  for f in find_files(inputdir, rootfile):
-    os.chdir(os.path.dirname(f))
-    print "Processing %s" %f
-    os.system("root -l -b -q \'%s(\"%s\")\'" %(script, f))
-    os.chdir(base)
+def main(inputdir, rootfile, nthreads):
+  script=os.path.join(os.path.abspath(os.path.dirname(sys.argv[0])), "batchProcess.cpp")
+  # All files are processed in one compiled batch session on a thread pool
+  # instead of one ROOT session per file
+  worklist = os.path.join(inputdir, "worklist_filter.txt")
+  with open(worklist, "w") as writer:
+    for f in find_files(inputdir, rootfile):
+      print("Processing %s" %f)
+      writer.write("filter %s\n" %f)
+  os.system("root -l -b -q \'%s+(\"%s\", %d)\'" %(script, worklist, nthreads))
 
 if __name__ == "__main__":
-    print("IMAHERE")
-    main(os.getcwd(), sys.argv[1])
+    main(os.getcwd(), sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 8)
@@ -11,7 +11,7 @@ void checkOutlierCut(const std::string_view mcfile){
   ROOT::EnableImplicitMT(8);
 
   auto ptbinning = getPtBinningPart("EJ1");
-  ROOT::RDataFrame df(GetNameJetSubstructureTree(mcfile), mcfile);
+  auto df = GetJetSubstructureFrame(mcfile);
 
   // Apply outlier cuts
   auto dataCut2 = df.Filter([](double ptsim, int pthardbin) { return !IsOutlier(ptsim, pthardbin, 2.); }, {"PtJetSim", "PtHardBin"});
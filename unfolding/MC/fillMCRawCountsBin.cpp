@@ -17,7 +17,7 @@ void fillMCRawCountsBin(const std::string_view filename){
   ROOT::EnableImplicitMT(8);
 
   auto ptbinning = getPtBinningPart("EJ1"), pthardbinning = getLinearBinning(21, -0.5, 20.5);
-  ROOT::RDataFrame df(GetNameJetSubstructureTree(filename), filename);
+  auto df = GetJetSubstructureFrame(filename);
   auto selected = df.Filter("ZgTrue >= 0.20 && ZgTrue < 0.25");
   auto weighted = selected.Histo2D({"hweighted", "weighted; pt-hard bin; p_{t,j} (GeV/c)", static_cast<int>(pthardbinning.size()-1), pthardbinning.data(), static_cast<int>(ptbinning.size()-1), ptbinning.data()}, "PtHardBin", "PtJetSim", "PythiaWeight");
   auto unweighted = selected.Histo2D({"hunweighted", "weighted; pt-hard bin; p_{t,j} (GeV/c)", static_cast<int>(pthardbinning.size()-1), pthardbinning.data(), static_cast<int>(ptbinning.size()-1), ptbinning.data()}, "PtHardBin", "PtJetSim");
@@ -41,6 +41,9 @@
 //#include "RooUnfoldTestHarness2D.h"
 #endif
 
+#include "../helpers/manifest.C"
+#include "../helpers/zonemap.C"
+
 TH2D *CorrelationHistShape(const TMatrixD &cov, const char *name, const char *title,
                            Int_t na, Int_t nb, Int_t kbin);
 TH2D *CorrelationHistPt(const TMatrixD &cov, const char *name, const char *title,
@@ -101,13 +104,19 @@ void RooSimpleMg(std::string_view filedata, std::string_view filemc)
 
   //////////GET THE DATA////////////
   std::unique_ptr<TFile> datafilereader(TFile::Open(filedata.data(), "READ"));
-  TTreeReader datareader(static_cast<TTree *>(datafilereader->Get("jetSubstructure")));
+  auto datakey = FindJetSubstructureKey(*datafilereader);
+  auto datatree = datakey ? datakey->ReadObject<TTree>() : nullptr;
+  if(!datatree) {
+    std::cerr << "No jet substructure tree found in " << filedata << std::endl;
+    return;
+  }
+  TTreeReader datareader(datatree);
   TTreeReaderValue<double>  ptrecData(datareader, "PtJetRec"), 
                             mgRecData(datareader, "MgMeasured");
-  for(auto en : datareader){
-    if(*ptrecData < 20 || *ptrecData > 200) continue;
+  ForEachEntryInRanges(datareader, GetSelectedEntryRanges(*datafilereader, datatree->GetName(), "PtJetRec", 20., 200.), [&]() {
+    if(*ptrecData < 20 || *ptrecData > 200) return;
     hraw->Fill(*mgRecData, *ptrecData);
-  }
+  });
 
   ////Get the MC////////////////////////
   // TDataFrame not supported in ROOUnfold (yet) - needs TTreeTreader
@@ -44,6 +44,8 @@
 //#include "RooUnfoldTestHarness2D.h"
 #endif
 
+#include "../helpers/bayesunfolding.C"
+
 TH2D *CorrelationHistShape(const TMatrixD &cov, const char *name, const char *title,
                            Int_t na, Int_t nb, Int_t kbin);
 TH2D *CorrelationHistPt(const TMatrixD &cov, const char *name, const char *title,
@@ -108,7 +110,6 @@ void RunUnfoldingJetMass(std::string_view filedata, std::string_view filemc)
   Int_t Ppol = 0;
   std::cout << "==================================== pick up the response matrix for background==========================" << std::endl;
   ///////////////////parameter setting
-  RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
 
   auto ptbinvec_smear = MakePtBinningSmeared(filedata); // Smeared binnning - only in the region one trusts the data
   std::vector<double> ptbinvec_true;
@@ -213,14 +214,16 @@ void RunUnfoldingJetMass(std::string_view filedata, std::string_view filemc)
   h2fulleff->SetName("truefull");
   h2fulleff->Write();
 
-  for (auto niter : ROOT::TSeqI(1, 35))
+  // iterations run once up to the last iteration, results of each iteration are snapshots
+  const Int_t MAXITERATIONS = 34;
+  IterativeBayesUnfolder unfold(response, hraw);
+  unfold.Run(MAXITERATIONS);
+  for (auto niter : ROOT::TSeqI(1, MAXITERATIONS + 1))
   {
     std::cout << "iteration" << niter << std::endl;
     std::cout << "==============Unfold h1=====================" << std::endl;
 
-    RooUnfoldBayes unfold(&response, hraw, niter); // OR
-    auto hunf = (TH2D *)unfold.Hreco(errorTreatment);
-    hunf->SetName(Form("mass_unfolded_iter%d", niter));
+    auto hunf = static_cast<TH2D *>(unfold.GetUnfolded(niter, Form("mass_unfolded_iter%d", niter)));
 
     // FOLD BACK
     // outer loop - reconstructed
@@ -285,7 +288,7 @@ void RunUnfoldingJetMass(std::string_view filedata, std::string_view filemc)
     if (niter == 4)
     {
 
-      TMatrixD covmat = unfold.Ereco((RooUnfold::ErrorTreatment)RooUnfold::kCovariance);
+      const TMatrixD &covmat = unfold.GetCovariance(niter);
       for (auto k : ROOT::TSeqI(0, h2true->GetNbinsX()))
       {
         auto covshape = CorrelationHistShape(covmat, Form("pearsonmatrix_iter%d_binshape%d", niter, k), "Covariance matrix", h2true->GetNbinsX(), h2true->GetNbinsY(), k);
@@ -14,6 +14,8 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -22,7 +24,6 @@
 
 #include "RStringView.h"
 #include "ROOT/TSeq.hxx"
-#include "ROOT/TProcessExecutor.hxx"
 #include "TH2D.h"
 #include "TFile.h"
 #include "TKey.h"
@@ -34,9 +35,13 @@
 //#include "RooUnfoldTestHarness2D.h"
 #endif
 
+#include "../helpers/bayesunfolding.C"
+#include "../helpers/bootstrap.C"
+#include "../helpers/executor.C"
 #include "../helpers/filesystem.C"
 #include "../helpers/string.C"
 #include "../helpers/unfolding.C"
+#include "../helpers/zonemap.C"
 
 //==============================================================================
 // Global definitions
@@ -83,14 +88,23 @@ TTree *GetDataTree(TFile &reader) {
   return result;
 }
 
-void RunUnfoldingZg(const std::string_view filedata, const std::string_view filemc)
+/**
+ * 2D unfolding (zg x pt) with RooUnfold-compatible Bayesian unfolding for all iterations
+ *
+ * With nbootstrap > 0 the statistical uncertainties are also determined with a
+ * Poisson bootstrap: data and response are filled in nbootstrap replicas with
+ * Poisson(1) weights per jet (the trees contain no event identifier), in the same
+ * pass over the trees, and each pair of replicas is unfolded. Mean and covariance
+ * of the replicas per iteration are written as zg_bootstrap_iter<n> and
+ * pearsonmatrix_bootstrap_iter<n>.
+ */
+void RunUnfoldingZg(const std::string_view filedata, const std::string_view filemc, int nbootstrap = 0)
 {
   ROOT::EnableThreadSafety();
   Int_t difference = 1;
   Int_t Ppol = 0;
   std::cout << "==================================== pick up the response matrix for background==========================" << std::endl;
   ///////////////////parameter setting
-  RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
 
   auto ptbinvec_smear = MakePtBinningSmeared(filedata); // Smeared binnning - only in the region one trusts the data
   std::vector<double> ptbinvec_true = {0., 20., 40., 60., 80., 100., 120., 140., 160., 180., 200., 220., 240., 280., 320., 360., 400.}; // True binning, needs overlap to over/underflow bins
@@ -117,6 +131,14 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
   response.Setup(h2smeared, h2true);
   responsenotrunc.Setup(h2smearednocuts, h2fulleff);
 
+  // bootstrap replicas of the data and of the response with reconstruction level cuts
+  std::unique_ptr<ReplicaSpectrum> rawreplicas;
+  std::unique_ptr<ReplicaResponse> responsereplicas;
+  if(nbootstrap > 0) {
+    rawreplicas = std::unique_ptr<ReplicaSpectrum>(new ReplicaSpectrum(hraw, nbootstrap));
+    responsereplicas = std::unique_ptr<ReplicaResponse>(new ReplicaResponse(h2smeared, h2true, nbootstrap));
+  }
+
   // define reconstruction level cuts
   auto smearptmin = *(std::min_element(ptbinvec_smear.begin(), ptbinvec_smear.end()));
   auto smearptmax = *(std::max_element(ptbinvec_smear.begin(), ptbinvec_smear.end()));
@@ -131,13 +153,17 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
   std::thread datathread([&]() {
     std::cout << "Datathread: Fill histograms from data" << std::endl;
     std::unique_ptr<TFile> datafilereader(TFile::Open(filedata.data(), "READ"));
-    TTreeReader datareader(GetDataTree(*datafilereader));
+    auto datatree = GetDataTree(*datafilereader);
+    TTreeReader datareader(datatree);
     TTreeReaderValue<double>  ptrecData(datareader, "PtJetRec"), 
                               zgRecData(datareader, "ZgMeasured");
-    for(auto en : datareader){
-      if(*ptrecData < smearptmin || *ptrecData > smearptmax) continue;
+    PoissonWeightGenerator bootstrapweights(std::max(nbootstrap, 1), 1001);
+    // only read clusters which can contain jets in the measured pt-range
+    ForEachEntryInRanges(datareader, GetSelectedEntryRanges(*datafilereader, datatree->GetName(), "PtJetRec", smearptmin, smearptmax), [&]() {
+      if(*ptrecData < smearptmin || *ptrecData > smearptmax) return;
       hraw->Fill(*zgRecData, *ptrecData);
-    }
+      if(rawreplicas) rawreplicas->Fill(*zgRecData, *ptrecData, 1., bootstrapweights.Next());
+    });
     std::cout << "Datathread: Data ready" << std::endl;
   });
 
@@ -153,6 +179,7 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
                               zgRec(mcreader, "ZgMeasured"), 
                               zgSim(mcreader, "ZgTrue"),
                               weight(mcreader, "PythiaWeight");
+    PoissonWeightGenerator bootstrapweights(std::max(nbootstrap, 1), 2002);
     for(auto en : mcreader){
       //if(*ptsim > 200.) continue;
       h2fulleff->Fill(*zgSim, *ptsim, *weight);
@@ -164,6 +191,7 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
       h2smeared->Fill(*zgRec, *ptrec, *weight);
       h2true->Fill(*zgSim, *ptsim, *weight);
       response.Fill(*zgRec, *ptrec, *zgSim, *ptsim, *weight);
+      if(responsereplicas) responsereplicas->Fill(*zgRec, *ptrec, *zgSim, *ptsim, *weight, bootstrapweights.Next());
     }
     std::cout << "MCthread: Response ready" << std::endl;
   });
@@ -191,55 +219,45 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
     efficiencies.emplace_back(efficiency);
   }
 
-  using resultformat = std::tuple<int, TH2 *, TH2 *, std::vector<TH2 *>, std::vector<TH2 *>>;
+  using resultformat = std::tuple<int, TH2 *, TH2 *, TH2 *>;
   const Int_t NWORKERS = 10;
   const Int_t MAXITERATIONS = 35;
-  auto workitem = [&](int workerID) {
-    std::vector<resultformat> result;
-    int nstep = 0;
-    while(true) {
-      auto niter = nstep * NWORKERS + workerID + 1;
-      if(niter > MAXITERATIONS) break;
-
-      std::cout << "iteration" << niter << std::endl;
-      std::cout << "==============Unfold h1=====================" << std::endl;
-
-      RooUnfoldBayes unfold(&response, hraw, niter); // OR
-      auto hunf = (TH2D *)unfold.Hreco(errorTreatment);
-      hunf->SetName(Form("zg_unfolded_iter%d.root", niter));
-
-      // FOLD BACK
-      auto hfold = Refold(hraw, hunf, response);
-      hfold->SetName(Form("zg_folded_iter%d.root", niter));
+  // iterations run once up to MAXITERATIONS, results of each iteration are snapshots
+  IterativeBayesUnfolder unfold(response, hraw);
+  unfold.Run(MAXITERATIONS);
+  std::vector<int> iterations;
+  for(auto niter : ROOT::TSeqI(1, MAXITERATIONS + 1)) iterations.emplace_back(niter);
+
+  // FOLD BACK: all iterations as one batch, uncertainties from the propagated covariance
+  RefoldingKernel refolder(response);
+  std::vector<const TVectorD *> spectra;
+  std::vector<const TMatrixD *> covariances;
+  for(auto niter : iterations) {
+    spectra.emplace_back(&unfold.GetUnfoldedVector(niter));
+    covariances.emplace_back(&unfold.GetCovariance(niter));
+  }
+  auto refolded = refolder.refoldBatch(hraw, spectra, covariances);
+  for(auto h : refolded) h->SetDirectory(nullptr);
 
-      //CheckNormalized(response, sizeof(zgbins)/sizeof(double)-1, sizeof(zgbins)/sizeof(double)-1, ptbinvec_true.size()-1, ptbinvec_smear.size()-1);
+  auto workitem = [&](int niter) {
+    auto hunf = static_cast<TH2 *>(unfold.GetUnfolded(niter, Form("zg_unfolded_iter%d.root", niter)));
 
-      TMatrixD covmat = unfold.Ereco((RooUnfold::ErrorTreatment)RooUnfold::kCovariance);
-      std::vector<TH2 *> shapematrices, ptmatrices;
-      for (auto k : ROOT::TSeqI(0, h2true->GetNbinsX()))
-        shapematrices.emplace_back(CorrelationHistShape(covmat, Form("pearsonmatrix_iter%d_binshape%d", niter, k), "Covariance matrix", h2true->GetNbinsX(), h2true->GetNbinsY(), k));
+    auto hfold = static_cast<TH2 *>(refolded[niter - 1]);
+    hfold->SetName(Form("zg_folded_iter%d.root", niter));
 
-      for (auto k : ROOT::TSeqI(0, h2true->GetNbinsY()))
-        ptmatrices.emplace_back(CorrelationHistPt(covmat, Form("pearsonmatrix_iter%d_binpt%d", niter, k), "Covariance matrix", h2true->GetNbinsX(), h2true->GetNbinsY(), k));
+    // full Pearson matrix, slices in pt and shape via CorrelationMatrix / GetCorrelationSlice
+    CorrelationMatrix pearson(unfold.GetCovariance(niter), h2true->GetNbinsX(), h2true->GetNbinsY());
+    auto hpearson = pearson.GetHistogram(Form("pearsonmatrix_iter%d", niter), "Pearson matrix");
 
-      result.emplace_back(std::make_tuple(niter, hunf, hfold, shapematrices, ptmatrices));
-      nstep++;
-    }
-    return result;
-  };
-  auto reducer = [](const std::vector<std::vector<resultformat>> &data){
-    std::vector<resultformat> result;
-    for(auto d : data) {
-      for(auto e : d) {
-        result.emplace_back(e);
-      }
-    }
-    std::sort(result.begin(), result.end(), [](const resultformat &first, const resultformat &second) { return std::get<0>(first) < std::get<0>(second); } );
-    return result;
+    return std::make_tuple(niter, hunf, hfold, hpearson);
   };
+  std::vector<resultformat> unfoldingresult = ParallelMap(workitem, iterations, NWORKERS);
 
-  ROOT::TProcessExecutor pool(NWORKERS);
-  auto unfoldingresult = pool.MapReduce(workitem, ROOT::TSeqI(0, NWORKERS), reducer);
+  std::map<int, WelfordAccumulator> bootstrap;
+  if(nbootstrap > 0) {
+    std::cout << "Unfolding " << nbootstrap << " bootstrap replicas" << std::endl;
+    bootstrap = BootstrapBayesUnfolding(*rawreplicas, *responsereplicas, MAXITERATIONS, {}, NWORKERS);
+  }
 
   auto tag = basename(filedata);
   tag.replace(tag.find(".root"), 5, "");
@@ -264,8 +282,14 @@ void RunUnfoldingZg(const std::string_view filedata, const std::string_view file
 
     std::get<1>(u)->Write();                        // Unfolded
     std::get<2>(u)->Write();                        // Refolded
-    for(auto m : std::get<3>(u)) m->Write();        // Response shape
-    for(auto m : std::get<4>(u)) m->Write();        // Response pt
+    std::get<3>(u)->Write();                        // Correlation matrix
+
+    auto bootstrapresult = bootstrap.find(std::get<0>(u));
+    if(bootstrapresult == bootstrap.end()) continue;
+    const auto &accumulator = bootstrapresult->second;
+    accumulator.GetHistogram(h2true, Form("zg_bootstrap_iter%d", std::get<0>(u)))->Write();
+    CorrelationMatrix pearson(accumulator.GetCovariance(), h2true->GetNbinsX(), h2true->GetNbinsY());
+    pearson.GetHistogram(Form("pearsonmatrix_bootstrap_iter%d", std::get<0>(u)), "Pearson matrix (bootstrap)")->Write();
   }
 }
 
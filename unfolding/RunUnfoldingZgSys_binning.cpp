@@ -38,7 +38,7 @@ void RunUnfoldingZgSys_binning(const std::string_view filedata, const std::strin
        zgbins_smear = getZgBinningFine(),
        zgbins_true = getZgBinningFine();
   auto dataextractor = [](const std::string_view filedata, double ptsmearmin, double ptsmearmax, TH2D *hraw, TList *optionals) {
-    ROOT::RDataFrame recframe(GetNameJetSubstructureTree(filedata), filedata);
+    auto recframe = GetJetSubstructureFrame(filedata);
     auto datahist = recframe.Filter(Form("PtJetRec > %f && PtJetRec < %f", ptsmearmin, ptsmearmax)).Histo2D(*hraw, "ZgMeasured", "PtJetRec");
     *hraw = *datahist;
   };
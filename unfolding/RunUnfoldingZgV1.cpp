@@ -21,6 +21,7 @@
 #include "../helpers/pthard.C"
 #include "../helpers/string.C"
 #include "../helpers/substructuretree.C"
+#include "../helpers/zonemap.C"
 #include "binnings/binningZg.C"
 #include "unfoldingGeneral.cpp"
 
@@ -38,9 +39,16 @@ void RunUnfoldingZgV1(const std::string_view filedata, const std::string_view fi
        zgbins_smear = getZgBinningFine(), 
        zgbins_true = getZgBinningFine(); 
   auto dataextractor = [](const std::string_view filedata, double ptsmearmin, double ptsmearmax, TH2D *hraw, TList *optionals) {
-    ROOT::RDataFrame recframe(GetNameJetSubstructureTree(filedata), filedata);
-    auto datahist = recframe.Filter(Form("PtJetRec > %f && PtJetRec < %f", ptsmearmin, ptsmearmax)).Histo2D(*hraw, "ZgMeasured", "PtJetRec");
-    *hraw = *datahist;
+    // only clusters which can contain jets in the measured pt-range are read
+    std::unique_ptr<TFile> datafilereader(TFile::Open(filedata.data(), "READ"));
+    auto datatree = GetDataTree(*datafilereader);
+    TTreeReader datareader(datatree);
+    TTreeReaderValue<double>  ptrec(datareader, "PtJetRec"),
+                              zgrec(datareader, "ZgMeasured");
+    ForEachEntryInRanges(datareader, GetSelectedEntryRanges(*datafilereader, datatree->GetName(), "PtJetRec", ptsmearmin, ptsmearmax), [&]() {
+      if(*ptrec <= ptsmearmin || *ptrec >= ptsmearmax) return;
+      hraw->Fill(*zgrec, *ptrec);
+    });
   };
   auto mcextractor = [fracSmearClosure](const std::string_view filename, double ptsmearmin, double ptsmearmax, TH2 *h2true, TH2 *h2trueClosure, TH2 *h2trueNoClosure, TH2 *h2smeared, TH2 *h2smearedClosure, TH2 *h2smearedNoClosure, TH2 *h2smearednocuts, TH2 *h2fulleff, RooUnfoldResponse &response, RooUnfoldResponse &responsenotrunc, RooUnfoldResponse &responseClosure, TList *optionals){
     std::unique_ptr<TFile> mcfilereader(TFile::Open(filename.data(), "READ"));
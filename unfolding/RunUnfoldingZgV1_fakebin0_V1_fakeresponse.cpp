@@ -35,7 +35,7 @@ const bool doFakeResponseMatrix = true;
 
 void RunUnfoldingZgV1_fakebin0_V1_fakeresponse(const std::string_view filedata, const std::string_view filemc, double nefcut = 0.98, double fracSmearClosure = 0.5){
   double fakeweight = 30.;
-  auto jetdef = getJetType(getFileTag(filedata));
+  auto jetdef = getJetDefinition(filedata);
   if(jetdef.fJetRadius == 0.3) fakeweight = 45;
   if(jetdef.fJetRadius == 0.4) fakeweight = 60.;
   if(jetdef.fJetRadius == 0.5) fakeweight = 100.;
@@ -47,7 +47,7 @@ void RunUnfoldingZgV1_fakebin0_V1_fakeresponse(const std::string_view filedata,
        zgbins_smear = getZgBinningFine(),
        zgbins_true = getZgBinningFine(); //getZgBinningCoarse();
   auto dataextractor = [nefcut, fakeweight](const std::string_view filedata, double ptsmearmin, double ptsmearmax, TH2D *hraw) {
-    ROOT::RDataFrame recframe(GetNameJetSubstructureTree(filedata), filedata);
+    auto recframe = GetJetSubstructureFrame(filedata);
     auto datahist = recframe.Filter(Form("NEFRec < %f && PtJetRec > %f && PtJetRec < %f", nefcut, ptsmearmin, ptsmearmax)).Histo2D(*hraw, "ZgMeasured", "PtJetRec");
     *hraw = *datahist;
     // Scale first bin
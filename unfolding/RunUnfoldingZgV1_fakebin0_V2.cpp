@@ -38,7 +38,7 @@ void RunUnfoldingZgV1_fakebin0_V2(const std::string_view filedata, const std::st
        zgbins_smear = getZgBinningFineFake(),
        zgbins_true = getZgBinningFineFake(); 
   auto dataextractor = [](const std::string_view filedata, double ptsmearmin, double ptsmearmax, TH2D *hraw, TList *optionals) {
-    ROOT::RDataFrame recframe(GetNameJetSubstructureTree(filedata), filedata);
+    auto recframe = GetJetSubstructureFrame(filedata);
     auto datahist = recframe.Filter(Form("PtJetRec > %f && PtJetRec < %f", ptsmearmin, ptsmearmax)).Define("FakeZg", [](double zg) {return zg < 0.1 ? 0.55 : zg; }, {"ZgMeasured"}).Histo2D(*hraw, "FakeZg", "PtJetRec");
     *hraw = *datahist;
   };
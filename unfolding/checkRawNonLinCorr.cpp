@@ -31,7 +31,7 @@ TGraph * readInverseNonLinCorr(const std::string_view filename) {
 
 TH1 *readSmearedMC(const std::string_view inputfile){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(inputfile), inputfile);
+    auto df = GetJetSubstructureFrame(inputfile);
     TH1 *result(nullptr);
     auto hist = df.Filter([](double ptsim, int ptbin) { return !IsOutlierFast(ptsim, ptbin); },{"PtJetSim", "PtHardBin"}).Histo1D({"spectrum", "spectrum", static_cast<int>(binning.size()-1), binning.data()}, "PtJetRec", "PythiaWeight");
     result = histcopy(hist.GetPtr());
@@ -45,7 +45,7 @@ PtCorrectionHists readSmearedData(const std::string_view inputfile, bool downsca
     auto lambdacorr = [fNonLinearityParams](double *x, double *p) { return fNonLinearityParams[6]/(fNonLinearityParams[0]*(1./(1.+fNonLinearityParams[1]*exp(-x[0]/fNonLinearityParams[2]))*1./(1.+fNonLinearityParams[3]*exp((x[0]-fNonLinearityParams[4])/fNonLinearityParams[5])))); };
     TF1 newcorrection("newcorrection", lambdacorr, 0., 200., 1);
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(inputfile), inputfile);
+    auto df = GetJetSubstructureFrame(inputfile);
     auto corrframe = df.Define("Theta", [](double eta) { return EtaToTheta(eta);}, {"EtaRec"})
                        .Define("EleadOld", "EJetRec * ZLeadingNeutralRec")
                        .Define("Eleadraw", [oldcorrection] (double eold) { return eold * oldcorrection->Eval(eold); }, {"EleadOld"})
@@ -98,7 +98,7 @@ PtCorrectionHists readSmearedData(const std::string_view inputfile, bool downsca
 
 std::vector<TH1 *> extractCENTNOTRDCorrection(std::string_view filename){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename), filename);
+    auto df = GetJetSubstructureFrame(filename);
     TH1 *result(nullptr);
     auto selCENT = df.Filter("TriggerClusterIndex < 1");
     auto speccentnotrd = df.Histo1D({"speccentnotrd", "Spectrum centnotrd", static_cast<int>(binning.size()) - 1, binning.data()}, "PtJetRec"),
@@ -75,7 +75,7 @@ void InspectZgBin0(const std::string_view filename, const std::string_view trigg
          ptpartmin = *ptbinningPart.begin(), ptpartmax = *ptbinningPart.rbegin();
   std::string filterptdet = Form("PtJetRec >= %f && PtJetRec < %f", ptdetmin, ptdetmax);
 
-  ROOT::RDataFrame zgframe(GetNameJetSubstructureTree(filename), filename);
+  auto zgframe = GetJetSubstructureFrame(filename);
   // define datasets
   auto data_truncated = zgframe.Filter(filterptdet);
   auto zgpart0 = data_truncated.Filter("ZgTrue < 0.1");
@@ -40,7 +40,7 @@ void getEffKine(const std::string_view trigger){
     cutname << "CutR" << std::setw(2) << std::setfill('0') << r;
     effname << "KineEffR" << std::setw(2) << std::setfill('0') << r;
     filename << "JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << r << "_INT7_merged.root"; 
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename.str().data()), filename.str().data());
+    auto df = GetJetSubstructureFrame(filename.str().data());
     auto full = df.Filter("NEFRec < 0.98").Histo2D({fullname.str().data(), "; z_{g}; p_{t,jet} (GeV/c)", int(zgbinning.size())-1, zgbinning.data(), int(ptbinning.size())-1, ptbinning.data()}, "ZgTrue", "PtJetSim", "PythiaWeight");
     auto cut = df.Filter(Form("NEFRec < 0.98 && PtJetRec > %f && PtJetRec < %f", range.first, range.second)).Histo2D({fullname.str().data(), "; z_{g}; p_{t,jet} (GeV/c)", int(zgbinning.size())-1, zgbinning.data(), int(ptbinning.size())-1, ptbinning.data()}, "ZgTrue", "PtJetSim", "PythiaWeight");
 
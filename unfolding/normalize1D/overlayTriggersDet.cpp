@@ -11,7 +11,7 @@ std::vector<std::string> triggers = {"INT7", "EJ1", "EJ2"};
 
 TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscaleweighted){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(inputfile), inputfile);
+    auto df = GetJetSubstructureFrame(inputfile);
     TH1 *result(nullptr);
     if(weighted){
         auto hist = df.Histo1D({"spectrum", "spectrum", static_cast<int>(binning.size()-1), binning.data()}, "PtJetRec", "PythiaWeight");
@@ -29,7 +29,7 @@ TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscale
 
 std::vector<TH1 *> extractCENTNOTRDCorrection(std::string_view filename){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename), filename);
+    auto df = GetJetSubstructureFrame(filename);
     TH1 *result(nullptr);
     auto selCENT = df.Filter("TriggerClusterIndex < 1");
     auto speccentnotrd = df.Histo1D({"speccentnotrd", "Spectrum centnotrd", static_cast<int>(binning.size()) - 1, binning.data()}, "PtJetRec"),
@@ -52,15 +52,15 @@ void makePlotPearson_pt(std::string_view filename){
     auto plot = new ROOT6tools::TSavableCanvas(Form("pearsonmatrixpt_%s_R%02d_%s", jd.fJetType.data(), int(jd.fJetRadius * 10.), jd.fTrigger.data()), "plot", 1200, 400 * ncol);
     plot->Divide(3, ncol);
 
+    auto unfolded = static_cast<TH2 *>(gDirectory->Get("zg_unfolded_iter4"));
+    int nbinsshape = unfolded->GetXaxis()->GetNbins(), nbinspt = unfolded->GetYaxis()->GetNbins();
+
     int panel = 1;
     int bincounter(0);
     for(auto ptbin : ptbins){
         bincounter++;
         plot->cd(panel);
-        std::stringstream histname;
-        histname << "pearsonmatrix_iter4_binzg" << (bincounter-1);
-
-        auto pearsonmatrix  = static_cast<TH2 *>(gDirectory->Get(histname.str().data()));
+        auto pearsonmatrix = GetCorrelationSlice(*gDirectory, 4, true, bincounter-1, nbinsshape, nbinspt, "binzg");
         pearsonmatrix->SetDirectory(nullptr);
         pearsonmatrix->GetXaxis()->SetTitle("p_{t,part} (GeV/c)");
         pearsonmatrix->GetYaxis()->SetTitle("p_{t,det} (GeV/c)");
@@ -58,15 +58,15 @@ void makePlotPearson_zg(std::string_view filename){
     auto plot = new ROOT6tools::TSavableCanvas(Form("pearsonmatrixzg_%s_R%02d_%s", jd.fJetType.data(), int(jd.fJetRadius * 10.), jd.fTrigger.data()), "plot", 1200, 400 * ncol);
     plot->Divide(3, ncol);
 
+    auto unfolded = static_cast<TH2 *>(gDirectory->Get("zg_unfolded_iter4"));
+    int nbinsshape = unfolded->GetXaxis()->GetNbins(), nbinspt = unfolded->GetYaxis()->GetNbins();
+
     int panel = 1;
     int bincounter(0);
     for(auto ptbin : ptbins){
         bincounter++;
         plot->cd(panel);
-        std::stringstream histname;
-        histname << "pearsonmatrix_iter4_binpt" << (bincounter-1);
-
-        auto pearsonmatrix  = static_cast<TH2 *>(gDirectory->Get(histname.str().data()));
+        auto pearsonmatrix = GetCorrelationSlice(*gDirectory, 4, false, bincounter-1, nbinsshape, nbinspt, "binpt");
         pearsonmatrix->SetDirectory(nullptr);
         pearsonmatrix->GetXaxis()->SetTitle("z_{g,part}");
         pearsonmatrix->GetYaxis()->SetTitle("z_{g,det}");
@@ -6,10 +6,10 @@ void extractResponseMatrixPtFineFromTree(const std::string_view treefile, bool w
     ROOT::EnableImplicitMT(8);
     auto tag = getFileTag(treefile);
     auto jd = getJetType(tag);
-    ROOT::RDataFrame dataframe(GetNameJetSubstructureTree(treefile), treefile);
+    auto dataframe = GetJetSubstructureFrame(treefile);
     std::vector<ROOT::RDF::RResultPtr<TH2D>> results;
     if(withoutliercut) {
-        auto rejectoutlier = dataframe.Define("Outlier", [](double ptsim, int pthardbin) { if(IsOutlierFast(ptsim, pthardbin)) return 1.; else return 0.; }, {"PtJetSim", "PtHardBin"}).Filter("Outlier < 1.");
+        auto rejectoutlier = dataframe.HasColumn("OutlierMask") ? ROOT::RDF::RNode(dataframe.Filter([](UChar_t mask) { return !IsOutlierFromMask(mask, 6.); }, {"OutlierMask"})) : ROOT::RDF::RNode(dataframe.Filter([](double ptsim, int pthardbin) { return !IsOutlierFast(ptsim, pthardbin); }, {"PtJetSim", "PtHardBin"}));
         results.push_back(rejectoutlier.Histo2D({"matrixfine_allptsim", "; p_{t,part} (GeV/c); p_{t,det} (GeV/c)", 180, 20., 200., 190, 10., 200.}, "PtJetSim", "PtJetRec", "PythiaWeight"));
         results.push_back(rejectoutlier.Define("PtJetDiff", "(PtJetRec - PtJetSim)/PtJetSim").Histo2D({"ptdiff_allptsim", "; p_{t,part} (GeV/c); p_{t,det} (GeV/c)", 200, 0., 200., 200, -1., 1.}, "PtJetSim", "PtJetDiff", "PythiaWeight"));
     } else {
@@ -3,8 +3,10 @@
 #include "../meta/roounfold.C"
 #include "../helpers/math.C"
 #include "../helpers/root.C"
+#include "../helpers/bayesunfolding.C"
 #include "../meta/root6tools.C"
 #include "../helpers/graphics.C"
+#include "../helpers/instrumentation.C"
 #include "../helpers/pthard.C"
 #include "../helpers/substructuretree.C"
 #include "../helpers/unfolding.C"
@@ -14,7 +16,7 @@ std::vector<std::string> triggers = {"INT7", "EJ1", "EJ2"};
 
 TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscaleweighted, bool dooutlierrejection){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(inputfile), inputfile);
+    auto df = GetJetSubstructureFrame(inputfile);
     TH1 *result(nullptr);
     if(weighted){
         if(dooutlierrejection){
@@ -43,7 +45,7 @@ TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscale
 
 std::vector<TH1 *> extractCENTNOTRDCorrection(std::string_view filename){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename), filename);
+    auto df = GetJetSubstructureFrame(filename);
     TH1 *result(nullptr);
     auto selCENT = df.Filter("TriggerClusterIndex < 1");
     auto speccentnotrd = df.Histo1D({"speccentnotrd", "Spectrum centnotrd", static_cast<int>(binning.size()) - 1, binning.data()}, "PtJetRec"),
@@ -223,6 +225,7 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
         *responseMatrixClosure = new TH2D("responseMatrixClosure", "response matrix (for closure test)", binningdet.size()-1, binningdet.data(), binningpart.size()-1, binningpart.data());
   
     {
+        ScopedTimer mctimer("fill response", "mc");
         TRandom closuresplit;
         std::stringstream filemc;
         filemc << datadir << "/mc/merged_calo/JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << int(radius*10.) << "_INT7_merged.root";
@@ -234,7 +237,9 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
                                   weight(mcreader, "PythiaWeight");
         TTreeReaderValue<int>     pthardbin(mcreader, "PtHardBin");
         bool closureUseSpectrum;
+        Long64_t nentries = 0;
         for(auto en : mcreader){
+            nentries++;
             if(IsOutlierFast(*ptsim, *pthardbin)) continue;
             double rdm = closuresplit.Uniform();
             closureUseSpectrum = (rdm < 0.2);
@@ -254,6 +259,8 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
                 }
             }
         }
+        Instrumentation::Instance().AddCounter("mc entries read", nentries);
+        Instrumentation::Instance().AddBytesDecompressed(*mcreader.GetTree(), nentries, {"PtJetRec", "PtJetSim", "NEFRec", "PythiaWeight", "PtHardBin"});
     }
 
     // Calculate kinematic efficiency
@@ -274,23 +281,27 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
 
     std::cout << "Running unfolding" << std::endl;
     std::map<std::string, std::vector<TObject *>> iterresults;
-    RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
     const double kSizeEmcalPhi = 1.88,
                  kSizeEmcalEta = 1.4;
     double acceptance = (kSizeEmcalPhi - 2 * radius) * (kSizeEmcalEta - 2 * radius) / (TMath::TwoPi());
     double crosssection = 57.8;
     double epsilon_vtx = 0.8228; // for the moment hard coded, for future analyses determined automatically from the output
-    for(auto iter : ROOT::TSeqI(1, 36)){
-        std::cout << "[Bayes unfolding] Doing iteration " << iter << "\n================================================================\n";
+    // all regularizations from a single run of the iterations
+    const int kMaxIterations = 35,
+              kIterationsClosure = 4;   // default number of iterations of RooUnfoldBayes
+    IterativeBayesUnfolder unfolder(response, hraw), unfolderClosure(responseClosure, hsmearedClosure);
+    {
+        ScopedTimer runtimer("iterations", "unfolding");
         std::cout << "[Bayes unfolding] Running unfolding" << std::endl;
-        RooUnfoldBayes unfolder(&response, hraw, iter);
-        auto unfolded = unfolder.Hreco(errorTreatment);
-        unfolded->SetName(Form("unfolded_iter%d", iter));
-        std::cout << "----------------------------------------------------------------------\n";
+        unfolder.Run(kMaxIterations);
         std::cout << "[Bayes unfolding] Running MC closure test" << std::endl;
-        RooUnfoldBayes unfolderClosure(&responseClosure, hsmearedClosure);
-        auto unfoldedClosure = unfolderClosure.Hreco(errorTreatment);
-        unfoldedClosure->SetName(Form("unfoldedClosure_iter%d", iter));
+        unfolderClosure.Run(kIterationsClosure, {kIterationsClosure});
+    }
+    for(auto iter : ROOT::TSeqI(1, kMaxIterations + 1)){
+        ScopedTimer itertimer(Form("iteration %d", iter), "unfolding");
+        std::cout << "[Bayes unfolding] Doing iteration " << iter << "\n================================================================\n";
+        auto unfolded = unfolder.GetUnfolded(iter, Form("unfolded_iter%d", iter));
+        auto unfoldedClosure = unfolderClosure.GetUnfolded(kIterationsClosure, Form("unfoldedClosure_iter%d", iter));
 
         // back-folding test
         std::cout << "----------------------------------------------------------------------\n";
@@ -320,6 +331,8 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
     // write everything
     std::cout << "----------------------------------------------------------------------\n";
     std::cout << "[Bayes unfolding] Writeing output" << std::endl;
+    Instrumentation::Instance().SampleMemory();
+    std::unique_ptr<ScopedTimer> outputtimer(new ScopedTimer("write output", "output"));
     std::unique_ptr<TFile> writer(TFile::Open(Form("corrected1DBayes_R%02d.root", int(radius*10.)), "RECREATE"));
     writer->mkdir("rawlevel");
     writer->cd("rawlevel");
@@ -351,6 +364,8 @@ void runCorrectionChain1DBayes(double radius, const std::string_view indatadir =
         for(auto h : iterresults.find(k)->second) h->Write();
     }
     std::cout << "----------------------------------------------------------------------\n";
+    outputtimer.reset();
+    Instrumentation::Instance().WriteTrace(Form("corrected1DBayes_R%02d_trace.json", int(radius*10.)));
     std::cout << "[Bayes unfolding] All done" << std::endl;
     std::cout << "======================================================================\n";
 }
\ No newline at end of file
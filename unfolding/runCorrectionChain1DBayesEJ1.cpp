@@ -3,6 +3,7 @@
 #include "../meta/roounfold.C"
 #include "../helpers/math.C"
 #include "../helpers/root.C"
+#include "../helpers/bayesunfolding.C"
 #include "../meta/root6tools.C"
 #include "../helpers/graphics.C"
 #include "../helpers/pthard.C"
@@ -14,7 +15,7 @@ std::vector<std::string> triggers = {"INT7", "EJ1"};
 
 TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscaleweighted, bool dooutlierrejection){
     auto binning = getJetPtBinningNonLinSmearLargeEJ1();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(inputfile), inputfile);
+    auto df = GetJetSubstructureFrame(inputfile);
     TH1 *result(nullptr);
     if(weighted){
         if(dooutlierrejection){
@@ -43,7 +44,7 @@ TH1 *readSmeared(const std::string_view inputfile, bool weighted, bool downscale
 
 std::vector<TH1 *> extractCENTNOTRDCorrection(std::string_view filename){
     auto binning = getJetPtBinningNonLinSmearLarge();
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename), filename);
+    auto df = GetJetSubstructureFrame(filename);
     TH1 *result(nullptr);
     auto selCENT = df.Filter("TriggerClusterIndex < 1");
     auto speccentnotrd = df.Histo1D({"speccentnotrd", "Spectrum centnotrd", static_cast<int>(binning.size()) - 1, binning.data()}, "PtJetRec"),
@@ -265,23 +266,23 @@ void runCorrectionChain1DBayesEJ1(double radius, const std::string_view indatadi
 
     std::cout << "Running unfolding" << std::endl;
     std::map<std::string, std::vector<TObject *>> iterresults;
-    RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
     const double kSizeEmcalPhi = 1.88,
                  kSizeEmcalEta = 1.4;
     double acceptance = (kSizeEmcalPhi - 2 * radius) * (kSizeEmcalEta - 2 * radius) / (TMath::TwoPi());
     double crosssection = 57.8;
     double epsilon_vtx = 0.8228; // for the moment hard coded, for future analyses determined automatically from the output
-    for(auto iter : ROOT::TSeqI(1, 36)){
+    // all regularizations from a single run of the iterations
+    const int kMaxIterations = 35,
+              kIterationsClosure = 4;   // default number of iterations of RooUnfoldBayes
+    IterativeBayesUnfolder unfolder(response, hraw), unfolderClosure(responseClosure, hsmearedClosure);
+    std::cout << "[Bayes unfolding] Running unfolding" << std::endl;
+    unfolder.Run(kMaxIterations);
+    std::cout << "[Bayes unfolding] Running MC closure test" << std::endl;
+    unfolderClosure.Run(kIterationsClosure, {kIterationsClosure});
+    for(auto iter : ROOT::TSeqI(1, kMaxIterations + 1)){
         std::cout << "[Bayes unfolding] Doing iteration " << iter << "\n================================================================\n";
-        std::cout << "[Bayes unfolding] Running unfolding" << std::endl;
-        RooUnfoldBayes unfolder(&response, hraw, iter);
-        auto unfolded = unfolder.Hreco(errorTreatment);
-        unfolded->SetName(Form("unfolded_iter%d", iter));
-        std::cout << "----------------------------------------------------------------------\n";
-        std::cout << "[Bayes unfolding] Running MC closure test" << std::endl;
-        RooUnfoldBayes unfolderClosure(&responseClosure, hsmearedClosure);
-        auto unfoldedClosure = unfolderClosure.Hreco(errorTreatment);
-        unfoldedClosure->SetName(Form("unfoldedClosure_iter%d", iter));
+        auto unfolded = unfolder.GetUnfolded(iter, Form("unfolded_iter%d", iter));
+        auto unfoldedClosure = unfolderClosure.GetUnfolded(kIterationsClosure, Form("unfoldedClosure_iter%d", iter));
 
         // back-folding test
         std::cout << "----------------------------------------------------------------------\n";
@@ -0,0 +1,469 @@
+#include "runCorrectionChain1DBayes.cpp"
+#include "../helpers/executor.C"
+
+/**
+ * @brief Systematic variation of the 1D correction chain
+ *
+ * Replaces the copies runCorrectionChain1DBayes_Sys* for variations which are
+ * based on the same input trees. Variations are declared in a configuration
+ * file, one variation per line:
+ *
+ *   <name> [binning=<default|option1..option4|loose|strong>] [zcut=<max. ZLeadingNeutralRec>] [effEJ2=1]
+ *          [trgeffscale=<scale>] [ptswap=<pt>] [prior=<file with unfolded result>]
+ *
+ * The name is the output directory (i.e. binning/option1), lines starting with #
+ * are ignored.
+ */
+struct CorrectionVariant {
+    std::string fName;
+    std::string fBinning = "default";   // detector-level binning (binning and truncation variations)
+    double fZCut = 2.;                  // max. ZLeadingNeutralRec (fake trigger variations), > 1: no cut
+    bool fEfficiencyEJ2 = false;        // correct EJ1 with the EJ2 trigger efficiency (fake trigger variations)
+    double fTriggerEffScale = 1.;       // scale of the trigger efficiency (capped at 1)
+    double fPtSwap = 70.;               // pt above which the EJ1 spectrum is used
+    std::string fPriorFile;             // unfolded result used to reweight the response (prior variations)
+};
+
+std::vector<double> getDetectorBinning(const std::string_view name) {
+    std::map<std::string, std::function<std::vector<double>()>> binnings = {
+        {"default", []() { return getJetPtBinningNonLinSmearLarge(); }},
+        {"option1", getJetPtBinningNonLinSmearLargeOption1},
+        {"option2", getJetPtBinningNonLinSmearLargeOption2},
+        {"option3", getJetPtBinningNonLinSmearLargeOption3},
+        {"option4", getJetPtBinningNonLinSmearLargeOption4},
+        {"loose", getJetPtBinningNonLinSmearLargeLoose},
+        {"strong", getJetPtBinningNonLinSmearLargeStrong}
+    };
+    auto found = binnings.find(std::string(name));
+    if(found == binnings.end()) return {};
+    return found->second();
+}
+
+std::vector<CorrectionVariant> getDefaultVariants() {
+    std::vector<CorrectionVariant> variants = {{"default"}};
+    for(const auto &option : {"option1", "option2", "option3", "option4"}) {
+        CorrectionVariant binningvariant{Form("binning/%s", option)};
+        binningvariant.fBinning = option;
+        variants.emplace_back(binningvariant);
+    }
+    for(const auto &option : {"loose", "strong"}) {
+        CorrectionVariant truncationvariant{Form("truncation/%s", option)};
+        truncationvariant.fBinning = option;
+        variants.emplace_back(truncationvariant);
+    }
+    CorrectionVariant trgeffloose{"triggereff/loose"}, trgeffstrong{"triggereff/strong"};
+    trgeffloose.fTriggerEffScale = 0.95;
+    trgeffstrong.fTriggerEffScale = 1.02;
+    variants.emplace_back(trgeffloose);
+    variants.emplace_back(trgeffstrong);
+    return variants;
+}
+
+std::vector<CorrectionVariant> readVariants(const std::string_view configfile) {
+    std::vector<CorrectionVariant> variants;
+    std::ifstream reader(configfile.data());
+    if(!reader.is_open()) {
+        std::cerr << "[Bayes unfolding] Cannot open configuration " << configfile << std::endl;
+        return variants;
+    }
+    std::string line;
+    while(std::getline(reader, line)) {
+        auto tokens = tokenize(line, ' ');
+        tokens.erase(std::remove(tokens.begin(), tokens.end(), ""), tokens.end());
+        if(!tokens.size() || tokens[0][0] == '#') continue;
+        CorrectionVariant variant{tokens[0]};
+        for(auto itoken = tokens.begin() + 1; itoken != tokens.end(); ++itoken) {
+            auto separator = itoken->find('=');
+            if(separator == std::string::npos) {
+                std::cerr << "[Bayes unfolding] Variation " << variant.fName << ": ignoring malformed setting " << *itoken << std::endl;
+                continue;
+            }
+            auto key = itoken->substr(0, separator), value = itoken->substr(separator + 1);
+            if(key == "binning") variant.fBinning = value;
+            else if(key == "zcut") variant.fZCut = std::stod(value);
+            else if(key == "effEJ2") variant.fEfficiencyEJ2 = std::stoi(value);
+            else if(key == "trgeffscale") variant.fTriggerEffScale = std::stod(value);
+            else if(key == "ptswap") variant.fPtSwap = std::stod(value);
+            else if(key == "prior") variant.fPriorFile = value;
+            else std::cerr << "[Bayes unfolding] Variation " << variant.fName << ": unknown setting " << key << std::endl;
+        }
+        variants.emplace_back(variant);
+    }
+    return variants;
+}
+
+/**
+ * Weight for the response in PtJetSim: ratio of the normalized unfolded
+ * spectrum (4 iterations) and the normalized MC truth spectrum of a previous
+ * unfolding. Returns nullptr if the prior file does not provide both spectra.
+ */
+TH1 *readPriorWeight(const std::string_view priorfile) {
+    std::unique_ptr<TFile> weightreader(TFile::Open(priorfile.data(), "READ"));
+    if(!weightreader || weightreader->IsZombie()) {
+        std::cerr << "[Bayes unfolding] Cannot open prior file " << priorfile << std::endl;
+        return nullptr;
+    }
+    auto readspectrum = [&](const char *dirname, const char *histname) -> std::unique_ptr<TH1> {
+        auto dir = weightreader->GetDirectory(dirname);
+        std::unique_ptr<TH1> hist(dir ? dir->Get<TH1>(histname) : nullptr);
+        if(!hist || hist->Integral() <= 0.) {
+            std::cerr << "[Bayes unfolding] Prior file " << priorfile << ": no spectrum " << dirname << "/" << histname << std::endl;
+            return nullptr;
+        }
+        hist->SetDirectory(nullptr);
+        normalizeBinWidth(hist.get());
+        hist->Scale(1./hist->Integral());
+        return hist;
+    };
+    auto unfoldedhist = readspectrum("iteration4", "unfolded_iter4");
+    auto weighttruefull = readspectrum("detectorresponse", "htrueFull");
+    if(!unfoldedhist || !weighttruefull) return nullptr;
+    auto responseweight = histcopy(unfoldedhist.get());
+    responseweight->SetDirectory(nullptr);
+    responseweight->SetNameTitle("responseweight", "Weight used for response smearing");
+    responseweight->Divide(weighttruefull.get());
+    return responseweight;
+}
+
+/**
+ * Histograms of one variation, filled in the common pass over the trees
+ */
+struct VariantHistograms {
+    const CorrectionVariant *fVariant;
+    std::vector<double> fBinningDet;
+    TH1 *fPriorWeight;
+    TRandom fClosureSplit;
+    std::map<std::string, TH1 *> fMCSpectra, fDataSpectra;
+    TH1 *fMCSpectrumINT7;                 // also in fMCSpectra, cached for the per-entry fill
+    TH1 *htrue, *hsmeared, *hsmearedClosure, *htrueClosure, *htrueFull, *htrueFullClosure, *hpriorsClosure;
+    TH2 *responseMatrix, *responseMatrixClosure;
+
+    VariantHistograms(const CorrectionVariant &variant, const std::vector<double> &binningpart, TH1 *priorweight) :
+        fVariant(&variant), fBinningDet(getDetectorBinning(variant.fBinning)), fPriorWeight(priorweight), fClosureSplit(), fMCSpectra(), fDataSpectra(), fMCSpectrumINT7(nullptr)
+    {
+        const auto &binningdet = fBinningDet;
+        htrue = new TH1D("htrue", "true spectrum", binningpart.size()-1, binningpart.data());
+        hsmeared = new TH1D("hsmeared", "det mc", binningdet.size()-1, binningdet.data());
+        hsmearedClosure = new TH1D("hsmearedClosure", "det mc (for closure test)", binningdet.size() - 1, binningdet.data());
+        htrueClosure = new TH1D("htrueClosure", "true spectrum (for closure test)", binningpart.size() - 1, binningpart.data());
+        htrueFull = new TH1D("htrueFull", "non-truncated true spectrum", binningpart.size() - 1, binningpart.data());
+        htrueFullClosure = new TH1D("htrueFullClosure", "non-truncated true spectrum (for closure test)", binningpart.size() - 1, binningpart.data());
+        hpriorsClosure = new TH1D("hpriorsClosure", "non-truncated true spectrum (for closure test, same jets as repsonse matrix)", binningpart.size() - 1, binningpart.data());
+        responseMatrix = new TH2D("responseMatrix", "response matrix", binningdet.size()-1, binningdet.data(), binningpart.size()-1, binningpart.data());
+        responseMatrixClosure = new TH2D("responseMatrixClosure", "response matrix (for closure test)", binningdet.size()-1, binningdet.data(), binningpart.size()-1, binningpart.data());
+        for(auto h : std::vector<TH1 *>{htrue, hsmeared, hsmearedClosure, htrueClosure, htrueFull, htrueFullClosure, hpriorsClosure, responseMatrix, responseMatrixClosure}) h->SetDirectory(nullptr);
+    }
+
+    bool acceptZ(double zneutral) const { return zneutral <= fVariant->fZCut; }
+
+    void fillMC(double ptrec, double ptsim, double weight) {
+        double priorweight = fPriorWeight ? fPriorWeight->GetBinContent(fPriorWeight->GetXaxis()->FindBin(ptsim)) : 1.;
+        double ptmin = fBinningDet.front(), ptmax = fBinningDet.back();
+        bool closureUseSpectrum = (fClosureSplit.Uniform() < 0.2);
+        htrueFull->Fill(ptsim, weight * priorweight);
+        if(closureUseSpectrum) htrueFullClosure->Fill(ptsim, weight);
+        else hpriorsClosure->Fill(ptsim, weight);
+        if(ptrec > ptmin && ptrec < ptmax){
+            htrue->Fill(ptsim, weight * priorweight);
+            hsmeared->Fill(ptrec, weight * priorweight);
+            responseMatrix->Fill(ptrec, ptsim, weight * priorweight);
+            if(closureUseSpectrum) {
+                hsmearedClosure->Fill(ptrec, weight);
+                htrueClosure->Fill(ptsim, weight);
+            } else {
+                responseMatrixClosure->Fill(ptrec, ptsim, weight);
+            }
+        }
+    }
+};
+
+/**
+ * Book the jet pt spectra for all variations on the data frame of one trigger,
+ * all histograms are filled in the same event loop
+ */
+std::vector<ROOT::RDF::RResultPtr<TH1D>> bookSpectra(ROOT::RDF::RNode df, const std::vector<VariantHistograms *> &variants, const char *weight, bool dooutlierrejection) {
+    auto selected = dooutlierrejection ? ROOT::RDF::RNode(df.Filter([](double ptsim, int ptbin) { return !IsOutlierFast(ptsim, ptbin); },{"PtJetSim", "PtHardBin"})) : df;
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> spectra;
+    for(auto v : variants) {
+        auto variantframe = v->fVariant->fZCut > 1. ? selected : ROOT::RDF::RNode(selected.Filter(Form("ZLeadingNeutralRec < %f", v->fVariant->fZCut)));
+        ROOT::RDF::TH1DModel model("spectrum", "spectrum", static_cast<int>(v->fBinningDet.size()-1), v->fBinningDet.data());
+        spectra.emplace_back(weight ? variantframe.Histo1D(model, "PtJetRec", weight) : variantframe.Histo1D(model, "PtJetRec"));
+    }
+    return spectra;
+}
+
+struct VariantResult {
+    TH1 *hraw;
+    TH1 *effKine, *effKineClosure;
+    std::map<std::string, TH1 *> efficiencies, ratios;
+    std::map<std::string, std::vector<TObject *>> iterresults;
+};
+
+/**
+ * Trigger efficiency correction, combination of the triggers and unfolding of one variation
+ */
+VariantResult correctVariant(VariantHistograms &hists, double radius) {
+    const auto &variant = *hists.fVariant;
+    VariantResult result;
+    auto reference = hists.fMCSpectra.find("INT7")->second;
+    TH1 *trgeffEJ2(nullptr);
+    if(variant.fEfficiencyEJ2) {
+        trgeffEJ2 = histcopy(hists.fMCSpectra.find("EJ2")->second);  // Assume EJ2 describes best EJ1
+        trgeffEJ2->SetName(Form("Efficiency_R%02d_%s", int(radius*10.), "EJ2"));
+        trgeffEJ2->Divide(trgeffEJ2, reference, 1., 1., "b");
+        result.efficiencies["EJ2"] = trgeffEJ2;
+    }
+    for(auto &trg : triggers) {
+        if(trg == "INT7") continue;
+        auto eff = trgeffEJ2;
+        if(!eff) {
+            eff = histcopy(hists.fMCSpectra.find(trg)->second);
+            eff->SetName(Form("Efficiency_R%02d_%s", int(radius*10.), trg.data()));
+            eff->Divide(eff, reference, 1., 1., "b");
+            if(variant.fTriggerEffScale != 1.) {
+                eff->Scale(variant.fTriggerEffScale);
+                for(auto b : ROOT::TSeqI(0, eff->GetXaxis()->GetNbins())){ // truncate trigger efficiency at 1
+                    if(eff->GetBinContent(b+1) > 1.) eff->SetBinContent(b+1, 1.);
+                }
+            }
+            result.efficiencies[trg] = eff;
+        }
+        hists.fDataSpectra.find(trg)->second->Divide(eff);
+    }
+
+    auto dataref = hists.fDataSpectra.find("INT7")->second;
+    for(auto &trg : triggers){
+        if(trg == "INT7") continue;
+        auto ratio = histcopy(hists.fDataSpectra.find(trg)->second);
+        ratio->SetName(Form("%soverMB_R%02d", trg.data(), int(radius*10)));
+        ratio->Divide(dataref);
+        result.ratios[trg] = ratio;
+    }
+
+    auto hraw = histcopy(dataref);
+    hraw->SetNameTitle("hraw", "raw spectrum from various triggers");
+    auto triggered = hists.fDataSpectra.find("EJ1")->second;
+    for(auto b : ROOT::TSeqI(0, hraw->GetNbinsX())){
+        if(hraw->GetXaxis()->GetBinCenter(b+1) < variant.fPtSwap) continue;       // Use data from INT7 trigger
+        hraw->SetBinContent(b+1, triggered->GetBinContent(b+1));
+        hraw->SetBinError(b+1, triggered->GetBinError(b+1));
+    }
+    result.hraw = hraw;
+
+    result.effKine = histcopy(hists.htrue);
+    result.effKine->SetName("effKine");
+    result.effKine->Divide(result.effKine, hists.htrueFull, 1., 1., "b");
+    result.effKineClosure = histcopy(hists.htrueClosure);
+    result.effKineClosure->SetName("effKineClosure");
+    result.effKineClosure->Divide(hists.htrueFullClosure);
+
+    RooUnfoldResponse response(nullptr, hists.htrueFull, hists.responseMatrix), responseClosure(nullptr, hists.hpriorsClosure, hists.responseMatrixClosure);
+    const double kSizeEmcalPhi = 1.88,
+                 kSizeEmcalEta = 1.4;
+    double acceptance = (kSizeEmcalPhi - 2 * radius) * (kSizeEmcalEta - 2 * radius) / (TMath::TwoPi());
+    double crosssection = 57.8;
+    double epsilon_vtx = 0.8228; // for the moment hard coded, for future analyses determined automatically from the output
+    const int kMaxIterations = 35,
+              kIterationsClosure = 4;   // default number of iterations of RooUnfoldBayes
+    IterativeBayesUnfolder unfolder(response, hraw), unfolderClosure(responseClosure, hists.hsmearedClosure);
+    unfolder.Run(kMaxIterations);
+    unfolderClosure.Run(kIterationsClosure, {kIterationsClosure});
+    RefoldingKernel refolder(response), refolderClosure(responseClosure);
+    for(auto iter : ROOT::TSeqI(1, kMaxIterations + 1)){
+        auto unfolded = unfolder.GetUnfolded(iter, Form("unfolded_iter%d", iter));
+        auto unfoldedClosure = unfolderClosure.GetUnfolded(kIterationsClosure, Form("unfoldedClosure_iter%d", iter));
+        auto backfolded = refolder.refold(hraw, unfolded);
+        backfolded->SetName(Form("backfolded_iter%d", iter));
+        auto backfoldedClosure = refolderClosure.refold(hists.hsmearedClosure, unfoldedClosure);
+        backfoldedClosure->SetName(Form("backfoldedClosure_iter%d", iter));
+        auto normalized = histcopy(unfolded);
+        normalized->SetNameTitle(Form("normalized_iter%d", iter), Form("Normalized for regularization %d", iter));
+        normalized->Scale(crosssection*epsilon_vtx/acceptance);
+        normalizeBinWidth(normalized);
+        result.iterresults[Form("iteration%d", iter)] = {unfolded, normalized, backfolded, unfoldedClosure, backfoldedClosure};
+    }
+    return result;
+}
+
+/**
+ * Correction chain for all systematic variations in one job
+ *
+ * Responses and raw spectra of all variations are booked together and filled
+ * in a single pass over each input tree (MC and data for all triggers), the
+ * variations are then corrected and unfolded concurrently. Each variation is
+ * written to <name>/corrected1DBayes_RXX.root, with the same content as the
+ * output of runCorrectionChain1DBayes. Luminosity and CENTNOTRD normalization
+ * are common to all variations.
+ *
+ * @param radius Jet radius
+ * @param configfile Configuration with the variations (see CorrectionVariant), default set if empty
+ * @param indatadir Directory with data and mc inputs
+ * @param nthreads Number of variations unfolded in parallel
+ */
+void runCorrectionChain1DBayesVariations(double radius, const std::string_view configfile = "", const std::string_view indatadir = "", int nthreads = 8){
+    ROOT::EnableThreadSafety();
+    std::string datadir;
+    if (indatadir.length()) datadir = std::string(indatadir);
+    else datadir = gSystem->GetWorkingDirectory();
+    auto variants = configfile.length() ? readVariants(configfile) : getDefaultVariants();
+    if(!variants.size()) {
+        std::cerr << "[Bayes unfolding] No variations defined, aborting" << std::endl;
+        return;
+    }
+    auto binningpart = getJetPtBinningNonLinTrueLarge();
+    std::vector<std::unique_ptr<VariantHistograms>> histograms;
+    std::vector<VariantHistograms *> active;
+    for(const auto &v : variants) {
+        if(!getDetectorBinning(v.fBinning).size()) {
+            std::cerr << "[Bayes unfolding] Variation " << v.fName << ": unknown binning " << v.fBinning << ", skipping" << std::endl;
+            continue;
+        }
+        TH1 *priorweight = nullptr;
+        if(v.fPriorFile.length() && !(priorweight = readPriorWeight(v.fPriorFile))) {
+            std::cerr << "[Bayes unfolding] Variation " << v.fName << ": invalid prior " << v.fPriorFile << ", skipping" << std::endl;
+            continue;
+        }
+        histograms.emplace_back(new VariantHistograms(v, binningpart, priorweight));
+        active.emplace_back(histograms.back().get());
+    }
+    std::cout << "[Bayes unfolding] Running " << active.size() << " variations" << std::endl;
+    bool needszcut = std::any_of(active.begin(), active.end(), [](const VariantHistograms *h) { return h->fVariant->fZCut <= 1.; });
+
+    // Normalization (common to all variations)
+    std::string normfilename = Form("%s/data/merged_17/AnalysisResults_split.root", datadir.data());
+    auto lumiCENT = extractLumiCENT(normfilename.data());
+    std::vector<TH1 *> centnotrdCorrection;
+    double cntcorrectionvalue = extractCENTNOTRDCorrectionFromClusterCounter(normfilename.data(), radius);
+    if(cntcorrectionvalue < 0){
+        // counter historgam not found (old output) - try with jet spectra
+        centnotrdCorrection = extractCENTNOTRDCorrection(Form("%s/data/merged_17/JetSubstructureTree_FullJets_R%02d_EJ1.root", datadir.data(), int(radius*10.)));
+        TF1 fit("centnotrdcorrfit", "pol0", 0., 200.);
+        centnotrdCorrection[2]->Fit(&fit, "N", "", 20., 200.);
+        cntcorrectionvalue = fit.GetParameter(0);
+    }
+    std::cout << "[Bayes unfolding] Using CENTNOTRD correction factor " << cntcorrectionvalue << std::endl;
+    auto lumiCENTNOTRD = lumiCENT * cntcorrectionvalue;
+    auto lumihist = new TH1D("luminosities", "Luminosities", 3, 0., 3.);
+    lumihist->SetDirectory(nullptr);
+    lumihist->GetXaxis()->SetBinLabel(1, "INT7");
+    lumihist->GetXaxis()->SetBinLabel(2, "CENT");
+    lumihist->GetXaxis()->SetBinLabel(3, "CENTNOTRD");
+    lumihist->SetBinContent(2, lumiCENT);
+    lumihist->SetBinContent(3, lumiCENTNOTRD);
+    auto weights = readNriggers(Form("%s/data/merged_1617/AnalysisResults_split.root", datadir.data()));
+    std::map<std::string, TH1 *> hnorm;
+    for(const auto &trg : triggers) {
+        auto trgweight = weights.find(trg)->second;
+        if(trg == "INT7") lumihist->SetBinContent(1, trgweight);
+        auto normhist = new TH1D(Form("norm%s", trg.data()), Form("event count trigger %s", trg.data()), 1, 0.5, 1.5);
+        normhist->SetDirectory(nullptr);
+        normhist->SetBinContent(1, trgweight);
+        hnorm[trg] = normhist;
+    }
+
+    // Data and triggered MC: one event loop per trigger for all variations
+    {
+        ScopedTimer spectimer("fill spectra", "io");
+        for(const auto &trg : triggers) {
+            std::stringstream filedata;
+            filedata << datadir << "/data/" << (trg == "INT7" ? "merged_1617" : "merged_17") << "/JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << int(radius*10.) << "_" << trg << ".root";
+            auto dataspectra = bookSpectra(GetJetSubstructureFrame(filedata.str()), active, trg == "EJ2" ? "EventWeight" : nullptr, false);
+            std::vector<ROOT::RDF::RResultPtr<TH1D>> mcspectra;
+            if(trg != "INT7") {
+                // INT7 MC spectra are filled together with the response
+                std::stringstream filemc;
+                filemc << datadir << "/mc/merged_calo/JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << int(radius*10.) << "_" << trg << "_merged.root";
+                mcspectra = bookSpectra(GetJetSubstructureFrame(filemc.str()), active, "PythiaWeight", true);
+            }
+            for(auto i : ROOT::TSeqI(0, active.size())) {
+                auto data = histcopy(dataspectra[i].GetPtr());
+                data->SetDirectory(nullptr);
+                data->SetName(Form("dataspec_R%02d_%s", int(radius*10.), trg.data()));
+                if(trg == "EJ1") data->Scale(1./lumiCENTNOTRD);
+                else if(trg == "EJ2") data->Scale(1./lumiCENT);
+                else data->Scale(1./weights.find(trg)->second);
+                active[i]->fDataSpectra[trg] = data;
+                if(mcspectra.size()) {
+                    auto mc = histcopy(mcspectra[i].GetPtr());
+                    mc->SetDirectory(nullptr);
+                    mc->SetName(Form("mcspec_R%02d_%s", int(radius*10.), trg.data()));
+                    active[i]->fMCSpectra[trg] = mc;
+                }
+            }
+        }
+    }
+
+    // Min. bias MC: responses and spectra of all variations in one pass
+    {
+        ScopedTimer mctimer("fill response", "mc");
+        for(auto h : active) {
+            auto mcspec = new TH1D(Form("mcspec_R%02d_INT7", int(radius*10.)), "spectrum", h->fBinningDet.size() - 1, h->fBinningDet.data());
+            mcspec->SetDirectory(nullptr);
+            h->fMCSpectra["INT7"] = h->fMCSpectrumINT7 = mcspec;
+        }
+        std::stringstream filemc;
+        filemc << datadir << "/mc/merged_calo/JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << int(radius*10.) << "_INT7_merged.root";
+        std::unique_ptr<TFile> fread(TFile::Open(filemc.str().data(), "READ"));
+        TTreeReader mcreader(GetDataTree(*fread));
+        TTreeReaderValue<double>  ptrec(mcreader, "PtJetRec"),
+                                  ptsim(mcreader, "PtJetSim"),
+                                  weight(mcreader, "PythiaWeight");
+        TTreeReaderValue<int>     pthardbin(mcreader, "PtHardBin");
+        std::unique_ptr<TTreeReaderValue<double>> zneutralrec;
+        if(needszcut) zneutralrec = std::unique_ptr<TTreeReaderValue<double>>(new TTreeReaderValue<double>(mcreader, "ZLeadingNeutralRec"));
+        // sequential on purpose: the closure split of each variation draws one random number
+        // per accepted entry, so the entry order must be reproducible
+        Long64_t nentries = 0;
+        for(auto en : mcreader){
+            nentries++;
+            if(IsOutlierFast(*ptsim, *pthardbin)) continue;
+            double zneutral = zneutralrec ? **zneutralrec : 0.;
+            for(auto h : active) {
+                if(zneutral < h->fVariant->fZCut) h->fMCSpectrumINT7->Fill(*ptrec, *weight);
+                if(!h->acceptZ(zneutral)) continue;
+                h->fillMC(*ptrec, *ptsim, *weight);
+            }
+        }
+        std::vector<std::string> mcbranches = {"PtJetRec", "PtJetSim", "PythiaWeight", "PtHardBin"};
+        if(needszcut) mcbranches.emplace_back("ZLeadingNeutralRec");
+        Instrumentation::Instance().AddCounter("mc entries read", nentries);
+        Instrumentation::Instance().AddBytesDecompressed(*mcreader.GetTree(), nentries, mcbranches);
+    }
+
+    // Correction and unfolding, variations in parallel
+    std::vector<VariantResult> results;
+    {
+        ScopedTimer unfoldtimer("unfolding", "unfolding");
+        results = ParallelMap([radius](VariantHistograms *h) { return correctVariant(*h, radius); }, active, nthreads);
+    }
+
+    std::unique_ptr<ScopedTimer> outputtimer(new ScopedTimer("write output", "output"));
+    for(auto i : ROOT::TSeqI(0, active.size())) {
+        const auto &hists = *active[i];
+        const auto &result = results[i];
+        gSystem->mkdir(hists.fVariant->fName.data(), true);
+        std::unique_ptr<TFile> writer(TFile::Open(Form("%s/corrected1DBayes_R%02d.root", hists.fVariant->fName.data(), int(radius*10.)), "RECREATE"));
+        writer->mkdir("rawlevel");
+        writer->cd("rawlevel");
+        result.hraw->Write();
+        lumihist->Write();
+        for(auto m : hists.fMCSpectra) {normalizeBinWidth(m.second); m.second->Write();}
+        for(auto d : hists.fDataSpectra) {normalizeBinWidth(d.second); d.second->Write();}
+        for(auto e : result.efficiencies) e.second->Write();
+        for(auto n : hnorm) n.second->Write();
+        for(auto r : result.ratios) r.second->Write();
+        for(auto c : centnotrdCorrection) c->Write();
+        if(hists.fPriorWeight) hists.fPriorWeight->Write();
+        writer->mkdir("detectorresponse");
+        writer->cd("detectorresponse");
+        for(auto h : std::vector<TH1 *>{hists.htrueFull, hists.htrueFullClosure, hists.htrue, hists.htrueClosure, hists.hpriorsClosure, hists.hsmeared, hists.hsmearedClosure, hists.responseMatrix, hists.responseMatrixClosure, result.hraw, result.effKine, result.effKineClosure}) h->Write();
+        for(const auto &k : getSortedKeys(result.iterresults)) {
+            writer->mkdir(k.data());
+            writer->cd(k.data());
+            for(auto h : result.iterresults.find(k)->second) h->Write();
+        }
+    }
+    outputtimer.reset();
+    Instrumentation::Instance().WriteTrace(Form("corrected1DBayesVariations_R%02d_trace.json", int(radius*10.)));
+    std::cout << "[Bayes unfolding] All done" << std::endl;
+}
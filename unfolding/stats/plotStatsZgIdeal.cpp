@@ -36,7 +36,7 @@ void plotStatsZgIdeal(const std::string_view trigger){
   for(auto r : ROOT::TSeqI(2, 6)) {
     std::stringstream filename;
     filename << "JetSubstructureTree_FullJets_R" << std::setw(2) << std::setfill('0') << r << "_" << trigger << ".root";
-    ROOT::RDataFrame df(GetNameJetSubstructureTree(filename.str()), filename.str());
+    auto df = GetJetSubstructureFrame(filename.str());
     std::stringstream histname;
     histname << "CountsZgPtIdealR" << std::setw(2) << std::setfill('0') << r;
     auto hist = df.Filter("NEFRec < 0.98").Histo2D({histname.str().data(), "; z_{g}; p_{t, jet} (GeV/c)", static_cast<int>(zgbinning.size())-1, zgbinning.data(), static_cast<int>(ptbinning.size())-1, ptbinning.data()}, "ZgMeasured", "PtJetRec");
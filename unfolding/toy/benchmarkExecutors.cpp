@@ -0,0 +1,158 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <ROOT/TProcessExecutor.hxx>
+#include <ROOT/TSeq.hxx>
+#include <TH1.h>
+#include <TMatrixD.h>
+#include <TStopwatch.h>
+#include <TSystem.h>
+
+#include "RooUnfoldBayes.h"
+#include "RooUnfoldResponse.h"
+#endif
+
+#include "../../helpers/bayesunfolding.C"
+#include "../../helpers/executor.C"
+#include "../../helpers/instrumentation.C"
+#include "../../helpers/unfolding.C"
+#include "toyresponse.C"
+
+// iteration, unfolded spectrum, covariance matrix, memory of the worker (MB)
+using scanresult = std::tuple<int, TH1 *, TMatrixD, double>;
+
+double residentMemory() {
+  ProcInfo_t info;
+  gSystem->GetProcInfo(&info);
+  return static_cast<double>(info.fMemResident) / 1024.;
+}
+
+/**
+ * Memory private to this process (MB), pages shared with other processes
+ * (i.e. copy-on-write pages of the parent in a forked worker) are not
+ * included. Negative if /proc/self/smaps_rollup is not available.
+ */
+double privateMemory() {
+  std::ifstream reader("/proc/self/smaps_rollup");
+  if(!reader.is_open()) return -1.;
+  std::string line, field;
+  double result = 0.;
+  while(std::getline(reader, line)) {
+    if(line.find("Private_") != 0) continue;
+    std::istringstream decoder(line);
+    double kb = 0.;
+    decoder >> field >> kb;
+    result += kb;
+  }
+  return result / 1024.;
+}
+
+scanresult unfoldIteration(const RooUnfoldResponse &response, const TH1 *measured, int niter) {
+  RooUnfoldBayes unfold(&response, measured, niter);
+  unfold.SetVerbose(0);
+  auto hunf = unfold.Hreco(RooUnfold::kCovariance);
+  hunf->SetName(Form("unfolded_iter%d", niter));
+  return std::make_tuple(niter, hunf, unfold.Ereco(RooUnfold::kCovariance), residentMemory());
+}
+
+void report(const std::string &model, double walltime, double memory) {
+  std::cout << "[" << model << "] wall time " << walltime << " s, memory ";
+  if(memory < 0) std::cout << "not available";
+  else std::cout << memory << " MB";
+  std::cout << std::endl;
+}
+
+/**
+ * Wall time and memory of the iteration scan for the execution models used in the unfolding
+ *
+ * - fork: TProcessExecutor with static split of the iterations over the workers and
+ *   reducer (model of unfoldingGeneral / RunUnfoldingZg before ParallelMap). Memory
+ *   is the resident memory of the parent plus the private memory of all workers,
+ *   so pages shared copy-on-write with the parent are counted once.
+ * - threads: ParallelMap, one task per iteration on the shared response
+ * - engine: ParallelMap over the iterations of a single IterativeBayesUnfolder run
+ *
+ * @param nworkers Number of workers / threads
+ * @param maxiterations Number of regularisation steps in the scan
+ * @param truebinwidth Bin width of the toy truth spectrum (sets the size of the response matrix)
+ */
+void benchmarkExecutors(int nworkers = 10, int maxiterations = 35, double truebinwidth = 2., int nevents = 1000000) {
+  ROOT::EnableThreadSafety();
+  auto toy = makeToyUnfoldingInput(nevents, truebinwidth);
+  const RooUnfoldResponse &response = *toy.fResponse;
+  const TH1 *measured = toy.fMeasured;
+  PrepareSharedResponse(response);
+  std::vector<int> iterations;
+  for(auto niter : ROOT::TSeqI(1, maxiterations + 1)) iterations.emplace_back(niter);
+  auto &instrumentation = Instrumentation::Instance();
+  TStopwatch timer;
+
+  // fork model
+  {
+    ScopedTimer scope("fork", "benchmark");
+    auto parentmemory = residentMemory();
+    timer.Start();
+    auto workitem = [&](int workerID) {
+      std::vector<scanresult> result;
+      for(auto niter = workerID + 1; niter <= maxiterations; niter += nworkers) result.emplace_back(unfoldIteration(response, measured, niter));
+      for(auto &r : result) std::get<3>(r) = privateMemory();
+      return result;
+    };
+    auto reducer = [](const std::vector<std::vector<scanresult>> &data) {
+      std::vector<scanresult> result;
+      for(const auto &d : data) result.insert(result.end(), d.begin(), d.end());
+      std::sort(result.begin(), result.end(), [](const scanresult &first, const scanresult &second) { return std::get<0>(first) < std::get<0>(second); });
+      return result;
+    };
+    ROOT::TProcessExecutor pool(nworkers);
+    auto result = pool.MapReduce(workitem, ROOT::TSeqI(0, nworkers), reducer);
+    timer.Stop();
+    // one memory sample per worker, taken after all iterations of the worker
+    std::vector<double> workermemory(nworkers, 0.);
+    bool hasprivate = true;
+    for(const auto &r : result) {
+      if(std::get<3>(r) < 0) hasprivate = false;
+      workermemory[(std::get<0>(r) - 1) % nworkers] = std::get<3>(r);
+    }
+    double memory = parentmemory;
+    for(auto m : workermemory) memory += m;
+    if(!hasprivate) memory = -1.;
+    report("fork", timer.RealTime(), memory);
+    for(auto &r : result) delete std::get<1>(r);
+  }
+
+  // thread model, same work per task
+  {
+    ScopedTimer scope("threads", "benchmark");
+    timer.Start();
+    auto result = ParallelMap([&](int niter) { return unfoldIteration(response, measured, niter); }, iterations, nworkers);
+    timer.Stop();
+    double memory = 0.;
+    for(const auto &r : result) memory = std::max(memory, std::get<3>(r));
+    report("threads", timer.RealTime(), std::max(memory, instrumentation.SampleMemory()));
+    for(auto &r : result) delete std::get<1>(r);
+  }
+
+  // thread model with snapshots of a single iterative unfolding
+  {
+    ScopedTimer scope("engine", "benchmark");
+    timer.Start();
+    IterativeBayesUnfolder unfold(response, measured);
+    unfold.Run(maxiterations);
+    auto result = ParallelMap([&](int niter) {
+      auto hunf = unfold.GetUnfolded(niter, Form("unfolded_iter%d", niter));
+      return std::make_tuple(niter, hunf, unfold.GetCovariance(niter), residentMemory());
+    }, iterations, nworkers);
+    timer.Stop();
+    double memory = 0.;
+    for(const auto &r : result) memory = std::max(memory, std::get<3>(r));
+    report("engine", timer.RealTime(), std::max(memory, instrumentation.SampleMemory()));
+    for(auto &r : result) delete std::get<1>(r);
+  }
+  instrumentation.WriteTrace("benchmarkExecutors_trace.json");
+}
@@ -0,0 +1,51 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <ROOT/TSeq.hxx>
+#include <TMatrixD.h>
+
+#include "RooUnfoldResponse.h"
+#endif
+
+#include "../../helpers/bayesunfolding.C"
+#include "../../helpers/bootstrap.C"
+#include "toyresponse.C"
+
+/**
+ * Regression test of the bootstrap engine
+ *
+ * Toy spectrum (makeToyUnfoldingInput) with bootstrap replicas of the measured
+ * spectrum only (response with unit weights), so that the spread of the replicas
+ * has to reproduce the covariance of the error propagation (RooUnfold::kCovariance).
+ * Uncertainties are compared for bins with an analytic relative uncertainty below
+ * 20%, the agreement is limited by the number of replicas (~1/sqrt(2 nreplicas)).
+ * The mean of the replicas has to agree with the nominal unfolded spectrum within
+ * its uncertainty.
+ */
+bool checkBootstrap(int nreplicas = 200, int iterations = 4, double tolerance = 0.2, int nevents = 1000000, int nthreads = 8) {
+  auto toy = makeToyUnfoldingInput(nevents, 10., nreplicas, false);
+  auto &response = *toy.fResponse;
+
+  IterativeBayesUnfolder engine(response, toy.fMeasured);
+  engine.Run(iterations, {iterations});
+  const auto &unfolded = engine.GetUnfoldedVector(iterations);
+  const auto &covariance = engine.GetCovariance(iterations);
+
+  auto bootstrap = BootstrapBayesUnfolding(*toy.fMeasuredReplicas, *toy.fResponseReplicas, iterations, {iterations}, nthreads);
+  const auto &accumulator = bootstrap[iterations];
+  const auto &mean = accumulator.GetMean();
+  auto bootstrapcovariance = accumulator.GetCovariance();
+
+  bool success = accumulator.GetEntries() == nreplicas;
+  for(auto i : ROOT::TSeqI(0, unfolded.GetNrows())) {
+    auto error = std::sqrt(std::max(covariance(i, i), 0.)), bootstraperror = std::sqrt(std::max(bootstrapcovariance(i, i), 0.));
+    if(unfolded[i] <= 0. || error / unfolded[i] > 0.2) continue;
+    bool passed = std::abs(bootstraperror / error - 1.) < tolerance && std::abs(mean[i] - unfolded[i]) < error;
+    std::cout << "Bin " << i << ": unfolded " << unfolded[i] << " +- " << error << ", bootstrap " << mean[i] << " +- " << bootstraperror << (passed ? " - OK" : " - FAILED") << std::endl;
+    success &= passed;
+  }
+  std::cout << "Bootstrap vs. error propagation (" << accumulator.GetEntries() << " replicas): " << (success ? "PASSED" : "FAILED") << std::endl;
+  return success;
+}
@@ -0,0 +1,67 @@
+#ifndef __CLING__
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <ROOT/TSeq.hxx>
+#include <TH1.h>
+#include <TMatrixD.h>
+
+#include "RooUnfoldBayes.h"
+#include "RooUnfoldResponse.h"
+#endif
+
+#include "../../helpers/bayesunfolding.C"
+#include "toyresponse.C"
+
+/**
+ * Largest relative deviation of the engine from RooUnfoldBayes for one iteration,
+ * for the unfolded spectrum and the covariance matrix (relative to the largest
+ * element, in order to be insensitive to elements compatible with 0)
+ */
+std::pair<double, double> compareIteration(RooUnfoldResponse &response, TH1 *measured, const IterativeBayesUnfolder &engine, int iter) {
+  RooUnfoldBayes reference(&response, measured, iter);
+  reference.SetVerbose(0);
+  std::unique_ptr<TH1> hreference(reference.Hreco(RooUnfold::kCovariance));
+  TMatrixD covreference = reference.Ereco(RooUnfold::kCovariance);
+  const auto &unfolded = engine.GetUnfoldedVector(iter);
+  const auto &covariance = engine.GetCovariance(iter);
+
+  double maxcontent = 0., maxcov = 0., diffcontent = 0., diffcov = 0.;
+  for(auto i : ROOT::TSeqI(0, unfolded.GetNrows())) {
+    maxcontent = std::max(maxcontent, std::abs(hreference->GetBinContent(i + 1)));
+    diffcontent = std::max(diffcontent, std::abs(hreference->GetBinContent(i + 1) - unfolded[i]));
+    for(auto j : ROOT::TSeqI(0, unfolded.GetNrows())) {
+      maxcov = std::max(maxcov, std::abs(covreference(i, j)));
+      diffcov = std::max(diffcov, std::abs(covreference(i, j) - covariance(i, j)));
+    }
+  }
+  return {maxcontent > 0. ? diffcontent / maxcontent : diffcontent, maxcov > 0. ? diffcov / maxcov : diffcov};
+}
+
+/**
+ * Regression test of IterativeBayesUnfolder against RooUnfoldBayes
+ *
+ * Toy spectrum (makeToyUnfoldingInput) unfolded with the engine once up to
+ * maxiterations and with RooUnfoldBayes for each number of iterations separately.
+ * Unfolded spectrum and covariance matrix have to agree within the tolerance.
+ */
+bool checkIterativeBayes(int maxiterations = 35, double tolerance = 1e-9, int nevents = 1000000) {
+  auto toy = makeToyUnfoldingInput(nevents);
+  auto &response = *toy.fResponse;
+  auto hmeasured = toy.fMeasured;
+
+  IterativeBayesUnfolder engine(response, hmeasured);
+  engine.Run(maxiterations);
+
+  bool success = true;
+  for(auto iter : ROOT::TSeqI(1, maxiterations + 1)) {
+    auto deviation = compareIteration(response, hmeasured, engine, iter);
+    bool passed = deviation.first < tolerance && deviation.second < tolerance;
+    std::cout << "Iteration " << iter << ": max. rel. deviation unfolded " << deviation.first << ", covariance " << deviation.second << (passed ? " - OK" : " - FAILED") << std::endl;
+    success &= passed;
+  }
+  std::cout << "IterativeBayesUnfolder vs. RooUnfoldBayes: " << (success ? "PASSED" : "FAILED") << std::endl;
+  return success;
+}
@@ -0,0 +1,69 @@
+#ifndef __CLING__
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <ROOT/TSeq.hxx>
+#include <TRandom3.h>
+#endif
+
+#include "../../helpers/pthard.C"
+
+/**
+ * Regression test of the outlier rejection
+ *
+ * Random jets (PtJetSim up to 20 x the upper edge of the pt-hard bin, bins
+ * including out-of-range values) are evaluated with the batch entry point
+ * (OutlierRejection::flag, FillOutlierMasks) and compared with the per-jet
+ * decision (isOutlier, GetOutlierMask) for all factors of the outlier mask.
+ * The mask has to decode (IsOutlierFromMask) to the per-jet decision, factors
+ * not stored in the mask have to be refused.
+ */
+bool checkOutlierRejection(int njets = 100000, unsigned int seed = 42) {
+  TRandom3 rng(seed);
+  std::vector<double> ptsim(njets);
+  std::vector<int> pthardbin(njets);
+  for(auto i : ROOT::TSeqI(0, njets)) {
+    pthardbin[i] = static_cast<int>(rng.Integer(kNPtHardBins + 2)) - 1;
+    double upperedge = kPtHardUpperEdgesDefault[pthardbin[i] >= 0 && pthardbin[i] < kNPtHardBins ? pthardbin[i] : 0];
+    ptsim[i] = rng.Uniform(0., 20. * upperedge);
+  }
+
+  bool success = true;
+  std::vector<unsigned char> flagged(njets);
+  for(auto factor : kOutlierMaskFactors) {
+    OutlierRejection rejection(factor);
+    rejection.flag(ptsim.data(), pthardbin.data(), njets, flagged.data());
+    int nmismatch = 0, noutlier = 0;
+    for(auto i : ROOT::TSeqI(0, njets)) {
+      bool reference = rejection.isOutlier(ptsim[i], pthardbin[i]);
+      if(reference) noutlier++;
+      if(static_cast<bool>(flagged[i]) != reference) nmismatch++;
+    }
+    std::cout << "Factor " << factor << ": " << noutlier << " outliers, " << nmismatch << " batch mismatches" << (nmismatch ? " - FAILED" : " - OK") << std::endl;
+    success &= nmismatch == 0;
+  }
+
+  std::vector<UChar_t> masks(njets);
+  FillOutlierMasks(ptsim.data(), pthardbin.data(), njets, masks.data());
+  int nmaskmismatch = 0;
+  for(auto i : ROOT::TSeqI(0, njets)) {
+    if(masks[i] != GetOutlierMask(ptsim[i], pthardbin[i])) nmaskmismatch++;
+    for(auto factor : kOutlierMaskFactors) {
+      if(IsOutlierFromMask(masks[i], factor) != IsOutlier(ptsim[i], pthardbin[i], factor)) nmaskmismatch++;
+    }
+  }
+  std::cout << "Outlier mask: " << nmaskmismatch << " mismatches" << (nmaskmismatch ? " - FAILED" : " - OK") << std::endl;
+  success &= nmaskmismatch == 0;
+
+  bool refused = false;
+  try {
+    IsOutlierFromMask(0, 7.);
+  } catch(std::invalid_argument &e) {
+    refused = true;
+  }
+  std::cout << "Factor not stored in the mask refused: " << (refused ? "OK" : "FAILED") << std::endl;
+  success &= refused;
+
+  std::cout << "Outlier rejection: " << (success ? "PASSED" : "FAILED") << std::endl;
+  return success;
+}
@@ -13,6 +13,7 @@
 #include "TSVDUnfold_local.h"
 #endif
 
+#include "../helpers/executor.C"
 #include "../helpers/filesystem.C"
 #include "../helpers/math.C"
 #include "../helpers/root.C"
@@ -29,7 +30,7 @@ void unfoldJetPtSpectrumBayes(const std::string_view filedata, const std::string
   std::string outfilename = Form("unfoldedEnergyBayes_%s.root", getFileTag(filedata).data());
 
   // read data
-  ROOT::RDataFrame df(GetNameJetSubstructureTree(filedata), filedata);
+  auto df = GetJetSubstructureFrame(filedata);
   auto model = df.Filter(Form("NEFRec < 0.98 &&  PtJetRec > %.1f && PtJetRec < %.1f", ptmin, ptmax)).Histo1D({"hraw", "raw spectrum", static_cast<int>(binningdet.size() -1), binningdet.data()}, "PtJetRec");
   auto hraw = model.GetPtr();
 
@@ -106,14 +107,22 @@ void unfoldJetPtSpectrumBayes(const std::string_view filedata, const std::string
   effKineClosure->Write();
 
   std::cout << "Running unfolding" << std::endl;
-  for(auto iter : ROOT::TSeqI(1, 36)){
-    std::cout << "[Bayes unfolding] Doing iteration " << iter << "\n================================================================\n";
-    std::cout << "[Bayes unfolding] Running unfolding" << std::endl;
+  // iterations scheduled with cost hints (cost grows linearly with the number of iterations)
+  const int kMaxIterations = 35, kNThreads = 10;
+  PrepareSharedResponse(response);
+  PrepareSharedResponse(responseClosure);
+  std::vector<int> iterations;
+  std::vector<double> costs;
+  for(auto iter : ROOT::TSeqI(1, kMaxIterations + 1)) {
+    iterations.emplace_back(iter);
+    costs.emplace_back(CostBayesUnfolding(iter, response.GetNbinsTruth(), response.GetNbinsMeasured()));
+  }
+  auto workitem = [&](int iter) {
+    std::cout << "[Bayes unfolding] Doing iteration " << iter << "\n";
     RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
     RooUnfoldBayes unfolder(&response, hraw, iter);
     auto unfolded = unfolder.Hreco(errorTreatment);
     unfolded->SetName(Form("unfolded_iter%d", iter));
-    std::cout << "[Bayes unfolding] Running MC closure test" << std::endl;
     RooUnfoldBayes unfolderClosure(&responseClosure, hsmearedClosure);
     auto unfoldedClosure = unfolderClosure.Hreco(errorTreatment);
     unfoldedClosure->SetName(Form("unfoldedClosure_iter%d", iter));
@@ -123,12 +132,13 @@ void unfoldJetPtSpectrumBayes(const std::string_view filedata, const std::string
     backfolded->SetName(Form("backfolded_iter%d", iter));
     auto backfoldedClosure = MakeRefolded1D(hsmearedClosure, unfoldedClosure, responseClosure);
     backfoldedClosure->SetName(Form("backfoldedClosure_iter%d", iter));
+    return std::vector<TH1 *>{unfolded, backfolded, unfoldedClosure, backfoldedClosure};
+  };
+  auto results = ScheduledMap(workitem, iterations, costs, kNThreads);
 
-    writer->mkdir(Form("iteration%d", iter));
-    writer->cd(Form("iteration%d", iter));
-    unfolded->Write();
-    backfolded->Write();
-    unfoldedClosure->Write();
-    backfoldedClosure->Write();
+  for(auto i : ROOT::TSeqI(0, iterations.size())) {
+    writer->mkdir(Form("iteration%d", iterations[i]));
+    writer->cd(Form("iteration%d", iterations[i]));
+    for(auto h : results[i]) h->Write();
   }
 }
\ No newline at end of file
@@ -30,7 +30,7 @@ void unfoldJetPtSpectrumSvd(const std::string_view filedata, const std::string_v
   std::string outfilename = Form("unfoldedEnergySvd_%s.root", getFileTag(filedata).data());
 
   // read data
-  ROOT::RDataFrame df(GetNameJetSubstructureTree(filedata), filedata);
+  auto df = GetJetSubstructureFrame(filedata);
   auto model = df.Filter(Form("NEFRec < 0.98 &&  PtJetRec > %.1f && PtJetRec < %.1f", ptmin, ptmax)).Histo1D({"hraw", "raw spectrum", static_cast<int>(binningdet.size() -1), binningdet.data()}, "PtJetRec");
   auto hraw = model.GetPtr();
 
@@ -14,16 +14,18 @@ class Workqueue:
         self.__tasks = []
         self.__lock = threading.Lock()
     
-    def addtask(self, task):
+    def addtask(self, task, cost = 0.):
+        # tasks are handed out most expensive first, cheap tasks fill the gaps at the end
         self.__lock.acquire(True)
-        self.__tasks.append(task)
+        self.__tasks.append((cost, task))
+        self.__tasks.sort(key = lambda entry : entry[0], reverse = True)
         self.__lock.release()
 
     def pop(self):
         task = None
         self.__lock.acquire(True)
         if len(self.__tasks):
-            task = self.__tasks.pop(0)
+            task = self.__tasks.pop(0)[1]
         self.__lock.release()
         return task
 
@@ -146,7 +148,8 @@ class TestRunner:
                         logging.error("MC file %s not found", mcfile)
                         continue
                     command = "root -l -b -q \'%s(\"%s\", \"%s\", \"%s\")\' | tee %s" % (testcase.getmacro(), datafile, mcfile, o, logfile_unfolding)
-                    workqueue.addtask(command)
+                    # cost hint: size of the input trees
+                    workqueue.addtask(command, os.path.getsize(datafile) + os.path.getsize(mcfile))
 
             tasks = []
             for itask in range(0, self.__nworkers):
@@ -20,7 +20,6 @@
 #include <vector>
 
 #include "ROOT/TSeq.hxx"
-#include "ROOT/TProcessExecutor.hxx"
 #include "RStringView.h"
 #include "TFile.h"
 #include "TH2D.h"
@@ -33,7 +32,10 @@
 //#include "RooUnfoldTestHarness2D.h"
 #endif
 
+#include "../helpers/bayesunfolding.C"
+#include "../helpers/executor.C"
 #include "../helpers/filesystem.C"
+#include "../helpers/instrumentation.C"
 #include "../helpers/unfolding.C"
 
 struct binning {
@@ -56,7 +58,6 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     std::cout << "Using explicit MT" << std::endl;
   }
   ///////////////////parameter setting
-  RooUnfold::ErrorTreatment errorTreatment = RooUnfold::kCovariance;
 
   const auto &binpttrue = histbinnings.binpttrue, &binptsmear = histbinnings.binptsmear, &binshapetrue = histbinnings.binshapetrue, &binshapesmear = histbinnings.binshapesmear;
   TH2D *hraw(new TH2D("hraw", "hraw", binshapesmear.size()-1, binshapesmear.data(), binptsmear.size()-1, binptsmear.data())),
@@ -96,7 +97,10 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     std::cout << "Data reader: Fill histograms from data" << std::endl;
     TStopwatch timerData;
     timerData.Start();
-    dataextractor(filedata, smearptmin, smearptmax, hraw, &optionals);
+    {
+      ScopedTimer datatimer("fill data", "data");
+      dataextractor(filedata, smearptmin, smearptmax, hraw, &optionals);
+    }
     timerData.Stop();
     std::cout << "Data reader: Data ready, duration " << timerData.RealTime() << std::endl;
 
@@ -104,6 +108,7 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     std::cout << "MCthread: Fill histograms from simulation" << std::endl;
     TStopwatch timerMC;
     timerMC.Start();
+    ScopedTimer mctimer("fill response", "mc");
     mcextractor(filemc, smearptmin, smearptmax, h2true, h2trueClosure, h2trueNoClosure, h2smeared, h2smearedClosure, h2smearedNoClosure, h2smearednocuts, h2fulleff, response, responsenotrunc, responseMCclosure, &optionals);
     timerMC.Stop();
     std::cout << "MCthread: Response ready, duration " << timerMC.RealTime() << std::endl;
@@ -119,6 +124,7 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
       std::cout << "Datathread: Fill histograms from data" << std::endl;
       TStopwatch timer;
       timer.Start();
+      ScopedTimer datatimer("fill data", "data");
       dataextractor(filedata, smearptmin, smearptmax, hraw, &optionals);
       timer.Stop();
       std::cout << "Datathread: Data ready, duration " << timer.RealTime() << std::endl;
@@ -129,6 +135,7 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
       std::cout << "MCthread: Fill histograms from simulation" << std::endl;
       TStopwatch timer;
       timer.Start();
+      ScopedTimer mctimer("fill response", "mc");
       mcextractor(filemc, smearptmin, smearptmax, h2true, h2trueClosure, h2trueNoClosure, h2smeared, h2smearedClosure, h2smearedNoClosure, h2smearednocuts, h2fulleff, response, responsenotrunc, responseMCclosure, &optionals);
       timer.Stop();
       std::cout << "MCthread: Response ready, duration " << timer.RealTime() << std::endl;
@@ -137,6 +144,12 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     mcthread.join();
   }
 
+  auto &instrumentation = Instrumentation::Instance();
+  instrumentation.AddCounter("data histogram entries", hraw->GetEntries());
+  instrumentation.AddCounter("mc histogram entries", h2fulleff->GetEntries());
+  instrumentation.SampleBytesRead();
+  instrumentation.SampleMemory();
+
   // reweight
   if(reweighter){
     reweighter(hraw, h2smeared, h2smearedClosure);
@@ -156,75 +169,69 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     efficiencies.emplace_back(efficiency);
   }
 
-  using resultformat = std::tuple<int, TH2 *, TH2 *, TH2 *, TH2 *, TH2 *, TH2 *, std::vector<TH2 *>, std::vector<TH2 *>>;
+  // normalised response matrices extracted once for the refolding of all iterations
+  RefoldingKernel refolder(response), refolderClosure(responseMCclosure);
+
+  using resultformat = std::tuple<int, TH2 *, TH2 *, TH2 *, TH2 *, TH2 *, TH2 *, TH2 *>;
   const Int_t NWORKERS = 10;
   const Int_t MAXITERATIONS = 35;
-  auto workitem = [&](int workerID) {
-    std::vector<resultformat> result;
-    int nstep = 0;
-    while(true) {
-      auto niter = nstep * NWORKERS + workerID + 1;
-      if(niter > MAXITERATIONS) break;
-
-      std::cout << "iteration" << niter << std::endl;
-      std::cout << "==============Unfold h1=====================" << std::endl;
-
-      RooUnfoldBayes unfold(&response, hraw, niter); // OR
-      auto hunf = (TH2D *)unfold.Hreco(errorTreatment);
-      hunf->SetName(Form("%s_unfolded_iter%d", observable.data(), niter));
-
-      // MC closure test
-      RooUnfoldBayes unfoldClosure(&responseMCclosure, h2smearedClosure, niter);
-      auto hunfClosure = (TH2 *)unfoldClosure.Hreco(errorTreatment);
-      hunfClosure->SetName(Form("%s_unfoldedClosure_iter%d", observable.data(), niter));
-
-      // MC closure test (self closure  - use full smeared and full response)
-      // not statistically independent any more
-      RooUnfoldBayes unfoldSelfClosure(&response, h2smeared, niter);
-      auto hunfSelfClosure = (TH2 *)unfoldSelfClosure.Hreco(errorTreatment);
-      hunfSelfClosure->SetName(Form("%s_unfoldedSelfClosure_iter%d", observable.data(), niter));
-
-      // FOLD BACK
-      auto hfold = Refold(hraw, hunf, response);
-      hfold->SetName(Form("%s_folded_iter%d", observable.data(), niter));
-
-      auto hfoldClosure = Refold(h2smearedClosure, hunfClosure, responseMCclosure);
-      hfoldClosure->SetName(Form("%s_foldedClosure_iter%d", observable.data(), niter));
-
-      auto hfoldSelfClosure = Refold(h2smeared, hunfSelfClosure, response);
-      hfoldSelfClosure->SetName(Form("%s_foldedSelfClosure_iter%d", observable.data(), niter));
-
-      //CheckNormalized(response, sizeof(zgbins)/sizeof(double)-1, sizeof(zgbins)/sizeof(double)-1, ptbinvec_true.size()-1, ptbinvec_smear.size()-1);
-
-      TMatrixD covmat = unfold.Ereco((RooUnfold::ErrorTreatment)RooUnfold::kCovariance);
-      std::vector<TH2 *> shapematrices, ptmatrices, responseMatricesShape;
-      for (auto k : ROOT::TSeqI(0, h2true->GetNbinsX()))
-        ptmatrices.emplace_back(CorrelationHistPt(covmat, Form("pearsonmatrix_iter%d_bin%s%d", niter, observable.data(), k), "Covariance matrix", h2true->GetNbinsX(), h2true->GetNbinsY(), k));
-
-      for (auto k : ROOT::TSeqI(0, h2true->GetNbinsY()))
-        shapematrices.emplace_back(CorrelationHistShape(covmat, Form("pearsonmatrix_iter%d_binpt%d", niter, k), "Covariance matrix", h2true->GetNbinsX(), h2true->GetNbinsY(), k));
-      
-      result.emplace_back(std::make_tuple(niter, hunf, hfold, hunfClosure, hunfSelfClosure, hfoldClosure, hfoldSelfClosure, shapematrices, ptmatrices));
-      nstep++;
-    }
-    return result;
+  std::unique_ptr<ScopedTimer> unfoldingtimer(new ScopedTimer("unfolding all iterations", "unfolding"));
+  // iterations run once up to MAXITERATIONS, results of each iteration are snapshots
+  // unfolders are set up here, responses and unfolders are shared read-only by the worker threads
+  IterativeBayesUnfolder unfold(response, hraw),
+                         unfoldClosure(responseMCclosure, h2smearedClosure),     // MC closure test
+                         unfoldSelfClosure(response, h2smeared);                 // MC self closure (full smeared and full response, not statistically independent)
+  std::vector<IterativeBayesUnfolder *> unfolders = {&unfold, &unfoldClosure, &unfoldSelfClosure};
+  ParallelMap([MAXITERATIONS](IterativeBayesUnfolder *unfolder) { unfolder->Run(MAXITERATIONS); return true; }, unfolders, NWORKERS);
+  std::vector<int> iterations;
+  for(auto niter : ROOT::TSeqI(1, MAXITERATIONS + 1)) iterations.emplace_back(niter);
+
+  // FOLD BACK: all iterations of an unfolder as one batch, uncertainties from the propagated covariance
+  struct RefoldingTask {
+    const RefoldingKernel *fKernel;
+    const IterativeBayesUnfolder *fUnfolder;
+    const TH1 *fTemplate;
   };
-  auto reducer = [](const std::vector<std::vector<resultformat>> &data){
-    std::vector<resultformat> result;
-    for(auto d : data) {
-      for(auto e : d) {
-        result.emplace_back(e);
-      }
+  std::vector<RefoldingTask> refoldingtasks = {{&refolder, &unfold, hraw}, {&refolderClosure, &unfoldClosure, h2smearedClosure}, {&refolder, &unfoldSelfClosure, h2smeared}};
+  auto refolded = ParallelMap([&iterations](const RefoldingTask &task) {
+    std::vector<const TVectorD *> spectra;
+    std::vector<const TMatrixD *> covariances;
+    for(auto niter : iterations) {
+      spectra.emplace_back(&task.fUnfolder->GetUnfoldedVector(niter));
+      covariances.emplace_back(&task.fUnfolder->GetCovariance(niter));
     }
-    std::sort(result.begin(), result.end(), [](const resultformat &first, const resultformat &second) { return std::get<0>(first) < std::get<0>(second); } );
-    return result;
+    return task.fKernel->refoldBatch(task.fTemplate, spectra, covariances);
+  }, refoldingtasks, NWORKERS);
+
+  auto workitem = [&](int niter) {
+    ScopedTimer itertimer(Form("iteration %d", niter), "unfolding");
+    auto hunf = static_cast<TH2 *>(unfold.GetUnfolded(niter, Form("%s_unfolded_iter%d", observable.data(), niter)));
+    auto hunfClosure = static_cast<TH2 *>(unfoldClosure.GetUnfolded(niter, Form("%s_unfoldedClosure_iter%d", observable.data(), niter)));
+    auto hunfSelfClosure = static_cast<TH2 *>(unfoldSelfClosure.GetUnfolded(niter, Form("%s_unfoldedSelfClosure_iter%d", observable.data(), niter)));
+
+    auto hfold = static_cast<TH2 *>(refolded[0][niter - 1]);
+    hfold->SetName(Form("%s_folded_iter%d", observable.data(), niter));
+
+    auto hfoldClosure = static_cast<TH2 *>(refolded[1][niter - 1]);
+    hfoldClosure->SetName(Form("%s_foldedClosure_iter%d", observable.data(), niter));
+
+    auto hfoldSelfClosure = static_cast<TH2 *>(refolded[2][niter - 1]);
+    hfoldSelfClosure->SetName(Form("%s_foldedSelfClosure_iter%d", observable.data(), niter));
+
+    // full Pearson matrix, slices in pt and shape via CorrelationMatrix / GetCorrelationSlice
+    CorrelationMatrix pearson(unfold.GetCovariance(niter), h2true->GetNbinsX(), h2true->GetNbinsY());
+    auto hpearson = pearson.GetHistogram(Form("pearsonmatrix_iter%d", niter), "Pearson matrix");
+
+    return std::make_tuple(niter, hunf, hfold, hunfClosure, hunfSelfClosure, hfoldClosure, hfoldSelfClosure, hpearson);
   };
+  std::vector<resultformat> unfoldingresult = ParallelMap(workitem, iterations, NWORKERS);
 
-  ROOT::TProcessExecutor pool(std::min(NWORKERS, MAXITERATIONS));
-  auto unfoldingresult = pool.MapReduce(workitem, ROOT::TSeqI(0, std::min(NWORKERS, MAXITERATIONS)), reducer);
+  unfoldingtimer.reset();
+  instrumentation.SampleMemory();
 
   auto tag = basename(filedata);
   tag.replace(tag.find(".root"), 5, "");
+  std::unique_ptr<ScopedTimer> outputtimer(new ScopedTimer("write output", "output"));
   std::unique_ptr<TFile> fout(TFile::Open(Form("%s_unfolded_%s.root", tag.data(), observable.data()), "RECREATE"));
   fout->cd();
   
@@ -248,14 +255,17 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
   // project response matrices
   fout->mkdir("sliceresponse");
   fout->cd("sliceresponse");
+  ResponseSlicer slicer(response.Hresponse(), static_cast<TH2 *>(response.Htruth()), static_cast<TH2 *>(response.Hmeasured()), observable.data());
   for(auto binpttrue : ROOT::TSeqI(0, h2true->GetYaxis()->GetNbins())){
     for(auto binptsmear : ROOT::TSeqI(0, h2smeared->GetYaxis()->GetNbins())){
-      sliceRepsonseObservable(response, observable.data(), binpttrue, binptsmear)->Write();
+      std::unique_ptr<TH2> slice(slicer.GetObservableSlice(binpttrue, binptsmear));
+      slice->Write();
     }
   }
   for(auto binshapetrue : ROOT::TSeqI(0, h2true->GetXaxis()->GetNbins())){
     for(auto binshapesmear : ROOT::TSeqI(0, h2smeared->GetXaxis()->GetNbins())){
-      sliceRepsonsePt(response, observable.data(), binshapetrue, binshapesmear)->Write();
+      std::unique_ptr<TH2> slice(slicer.GetPtSlice(binshapetrue, binshapesmear));
+      slice->Write();
     }
   }
 
@@ -270,7 +280,8 @@ void unfoldingGeneral(const std::string_view observable, const std::string_view
     std::get<4>(u)->Write();                        // Unfolded, MC self-closure
     std::get<5>(u)->Write();                        // Refolded, MC closure
     std::get<6>(u)->Write();                        // Refolded, MC self-closure
-    for(auto m : std::get<7>(u)) m->Write();        // Correlation shape
-    for(auto m : std::get<8>(u)) m->Write();        // Correlation pt
+    std::get<7>(u)->Write();                        // Correlation matrix
   }
-}
\ No newline at end of file
+  outputtimer.reset();
+  instrumentation.WriteTrace(Form("%s_unfolded_%s_trace.json", tag.data(), observable.data()));
+}